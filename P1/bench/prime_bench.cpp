@@ -0,0 +1,221 @@
+// Benchmark harness for the four P1 variants.
+// Runs every selected partitioning / output combination over a grid of
+// THREAD_COUNT x MAX_NUMBER values, with warmup runs and repeated trials, and
+// reports median / p99 wall time, throughput and scaling efficiency as a
+// table (stderr), CSV and JSON.
+//
+// Each trial is timed with steady_clock around the whole search - worker
+// startup, the search, and the print phase of the batched variants - but not
+// config parsing. The primes themselves go to the null device, so the
+// numbers don't depend on how fast the terminal scrolls.
+//
+// Usage: prime_bench [bench config]   (defaults to bench.ini)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../core/prime_search.h"
+
+namespace {
+
+using SearchFn = int (*)(const SearchSettings&, std::chrono::high_resolution_clock::time_point);
+
+struct Variant {
+    int number;
+    const char* partition;
+    const char* output;
+    SearchFn run;
+};
+
+const Variant kVariants[] = {
+    {1, RangeDivision::kName, ImmediatePrint::kName, &runSearch<RangeDivision, ImmediatePrint>},
+    {2, RangeDivision::kName, BatchedPrint::kName, &runSearch<RangeDivision, BatchedPrint>},
+    {3, NumberDivision::kName, ImmediatePrint::kName, &runSearch<NumberDivision, ImmediatePrint>},
+    {4, NumberDivision::kName, BatchedPrint::kName, &runSearch<NumberDivision, BatchedPrint>},
+};
+
+// one grid cell: a variant at one THREAD_COUNT / MAX_NUMBER
+struct Result {
+    const Variant* variant;
+    long long threads;
+    long long max_number;
+    long long numbers;
+    std::vector<double> samples_ms;  // sorted
+    double median_ms = 0;
+    double p99_ms = 0;
+    double mean_ms = 0;
+    double numbers_per_sec = 0;
+    double scaling_efficiency = 0;   // vs. the smallest thread count of the same variant / MAX_NUMBER
+};
+
+// "1,2,4" (or a single number) from either config map
+std::vector<long long> readList(std::map<std::string, long long>& config, std::map<std::string, std::string>& text_config,
+                                const std::string& key, const std::string& fallback) {
+    std::string text = fallback;
+    if (config.count(key)) text = std::to_string(config[key]);
+    else if (text_config.count(key)) text = text_config[key];
+
+    std::vector<long long> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        try {
+            values.push_back(std::stoll(item));
+        } catch (const std::exception&) {
+            std::cerr << "Ignoring bad " << key << " entry '" << item << "'" << std::endl;
+        }
+    }
+    return values;
+}
+
+// median, p99 (nearest rank) and mean of the sorted samples
+void summarize(Result& r) {
+    std::vector<double>& s = r.samples_ms;
+    std::sort(s.begin(), s.end());
+    std::size_t n = s.size();
+    r.median_ms = (n % 2) ? s[n / 2] : (s[n / 2 - 1] + s[n / 2]) / 2;
+    std::size_t rank = (99 * n + 99) / 100; // ceil(0.99 * n)
+    r.p99_ms = s[rank - 1];
+    double sum = 0;
+    for (double ms : s) sum += ms;
+    r.mean_ms = sum / n;
+    r.numbers_per_sec = (r.median_ms > 0) ? r.numbers / (r.median_ms / 1000.0) : 0;
+}
+
+// runs the search once with stdout on the null device, returns wall time in ms
+double timeTrial(const Variant& variant, const SearchSettings& settings) {
+    auto start = std::chrono::steady_clock::now();
+    variant.run(settings, std::chrono::high_resolution_clock::now());
+    std::cout.flush();
+    std::fflush(stdout);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void writeCsv(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    out << "variant,partition,output,threads,max_number,trials,median_ms,p99_ms,mean_ms,min_ms,numbers_per_sec,scaling_efficiency\n";
+    out << std::fixed << std::setprecision(3);
+    for (const Result& r : results) {
+        out << r.variant->number << "," << r.variant->partition << "," << r.variant->output << ","
+            << r.threads << "," << r.max_number << "," << r.samples_ms.size() << ","
+            << r.median_ms << "," << r.p99_ms << "," << r.mean_ms << "," << r.samples_ms.front() << ","
+            << r.numbers_per_sec << "," << r.scaling_efficiency << "\n";
+    }
+    std::cerr << "CSV written to " << path << std::endl;
+}
+
+void writeJson(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    out << std::fixed << std::setprecision(3) << "[\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "  {\"variant\": " << r.variant->number
+            << ", \"partition\": \"" << r.variant->partition << "\", \"output\": \"" << r.variant->output << "\""
+            << ", \"threads\": " << r.threads << ", \"max_number\": " << r.max_number
+            << ", \"samples_ms\": [";
+        for (std::size_t k = 0; k < r.samples_ms.size(); ++k) {
+            out << (k ? ", " : "") << r.samples_ms[k];
+        }
+        out << "], \"median_ms\": " << r.median_ms << ", \"p99_ms\": " << r.p99_ms << ", \"mean_ms\": " << r.mean_ms
+            << ", \"numbers_per_sec\": " << r.numbers_per_sec << ", \"scaling_efficiency\": " << r.scaling_efficiency
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+    std::cerr << "JSON written to " << path << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string config_path = (argc >= 2) ? argv[1] : "bench.ini";
+    std::map<std::string, long long> config;
+    std::map<std::string, std::string> text_config;
+    if (!loadConfig(config_path, config, text_config)) return 1;
+
+    // everything that isn't a grid key (ALGORITHM, SCHEDULER, ...) applies to every run
+    SearchSettings base;
+    applySettings(config, text_config, base);
+
+    std::vector<long long> variants = readList(config, text_config, "VARIANTS", "1,2,3,4");
+    std::vector<long long> threads = readList(config, text_config, "THREADS", "1,2,4");
+    std::vector<long long> max_numbers = readList(config, text_config, "MAX_NUMBERS", "100000,1000000");
+    long long warmup = config.count("WARMUP") ? config["WARMUP"] : 1;
+    long long trials = config.count("TRIALS") ? config["TRIALS"] : 5;
+    std::string csv_path = text_config.count("CSV_FILE") ? text_config["CSV_FILE"] : "bench_results.csv";
+    std::string json_path = text_config.count("JSON_FILE") ? text_config["JSON_FILE"] : "bench_results.json";
+    if (trials < 1) trials = 1;
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::remove_if(threads.begin(), threads.end(), [](long long t) { return t < 1; }), threads.end());
+
+    // the variants print every prime; send that to the null device
+#if defined(_WIN32)
+    const char* null_device = "NUL";
+#else
+    const char* null_device = "/dev/null";
+#endif
+    if (!std::freopen(null_device, "w", stdout)) {
+        std::cerr << "Could not redirect stdout to " << null_device << std::endl;
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (long long v : variants) {
+        if (v < 1 || v > 4) {
+            std::cerr << "Skipping unknown variant " << v << std::endl;
+            continue;
+        }
+        const Variant& variant = kVariants[v - 1];
+        for (long long max_number : max_numbers) {
+            std::size_t first_of_sweep = results.size();
+            for (long long t : threads) {
+                SearchSettings settings = base;
+                settings.thread_count = t;
+                settings.max_number = max_number;
+
+                std::cerr << "Variant " << v << ", " << t << " threads, MAX_NUMBER=" << max_number << " ..." << std::flush;
+                for (long long w = 0; w < warmup; ++w) timeTrial(variant, settings);
+
+                Result r;
+                r.variant = &variant;
+                r.threads = t;
+                r.max_number = max_number;
+                r.numbers = (settings.min_number > 2) ? max_number - settings.min_number + 1 : max_number;
+                for (long long k = 0; k < trials; ++k) r.samples_ms.push_back(timeTrial(variant, settings));
+                summarize(r);
+                std::cerr << " median " << r.median_ms << " ms" << std::endl;
+                results.push_back(r);
+            }
+
+            // scaling efficiency: speedup over the smallest thread count, divided by the thread ratio
+            const Result& base_run = results[first_of_sweep];
+            for (std::size_t i = first_of_sweep; i < results.size(); ++i) {
+                Result& r = results[i];
+                r.scaling_efficiency = (r.median_ms > 0)
+                    ? (base_run.median_ms * base_run.threads) / (r.median_ms * r.threads) : 0;
+            }
+        }
+    }
+
+    std::cerr << std::endl << std::left << std::setw(4) << "Var" << std::setw(9) << "Threads" << std::setw(14) << "MAX_NUMBER"
+              << std::setw(13) << "Median ms" << std::setw(13) << "p99 ms" << std::setw(17) << "Numbers/sec"
+              << "Efficiency" << std::endl;
+    std::cerr << std::fixed << std::setprecision(2);
+    for (const Result& r : results) {
+        std::cerr << std::setw(4) << r.variant->number << std::setw(9) << r.threads << std::setw(14) << r.max_number
+                  << std::setw(13) << r.median_ms << std::setw(13) << r.p99_ms << std::setw(17) << std::setprecision(0)
+                  << r.numbers_per_sec << std::setprecision(2) << r.scaling_efficiency << std::endl;
+    }
+    std::cerr << std::endl;
+
+    if (!csv_path.empty()) writeCsv(csv_path, results);
+    if (!json_path.empty()) writeJson(json_path, results);
+    return 0;
+}
@@ -0,0 +1,34 @@
+// Cluster mode: spreads one prime search over several processes or machines
+// (see core/cluster.h). Start the coordinator, then any number of workers;
+// workers can join late or die halfway, their segments are handed out again.
+//
+// Usage: prime_cluster coordinator [config] [--KEY=value ...]
+//        prime_cluster worker <coordinator host> [config] [--KEY=value ...]
+// (the config defaults to cluster.ini; workers read THREAD_COUNT and
+// CLUSTER_PORT from it, everything else comes from the coordinator)
+#include <iostream>
+#include <string>
+
+#include "../core/cluster.h"
+
+int main(int argc, char* argv[]) {
+    std::string role = (argc >= 2) ? argv[1] : "";
+    bool worker = (role == "worker");
+    if ((role != "coordinator" && !worker) || (worker && argc < 3)) {
+        std::cerr << "Usage: " << argv[0] << " coordinator [config] | worker <host> [config] [--KEY=value ...]" << std::endl;
+        return 1;
+    }
+    int first_arg = worker ? 3 : 2;
+
+    SearchSettings settings;
+    if (!loadSettings(argc - first_arg, argv + first_arg, "cluster.ini", settings)) return 1;
+    if (!initNetworking()) {
+        std::cerr << "Error: Could not start networking" << std::endl;
+        return 1;
+    }
+    if (worker) return ClusterWorker(settings).run(argv[2]);
+
+    std::cout << "--- Cluster coordinator ---" << std::endl;
+    std::cout << "Run START: " << getCurrentTimestamp() << std::endl;
+    return ClusterCoordinator(settings).run();
+}
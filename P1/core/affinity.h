@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Worker thread placement (AFFINITY in the config):
+//   none    - threads float wherever the OS puts them (the default)
+//   compact - fill the CPUs of one NUMA node before moving to the next
+//   spread  - deal the workers round-robin over the NUMA nodes
+// Each worker pins itself as its first step, before it allocates anything,
+// so the OS's first-touch policy puts its buffers on its own node.
+
+struct NumaTopology {
+    std::vector<std::vector<int>> node_cpus; // CPUs this process may use, per node
+};
+
+#if !defined(_WIN32)
+// "0-3,8-11" -> 0 1 2 3 8 9 10 11
+inline std::vector<int> parseCpuList(const std::string& text) {
+    std::vector<int> cpus;
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        std::size_t comma = text.find(',', pos);
+        std::string part = text.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        int lo, hi;
+        if (std::sscanf(part.c_str(), "%d-%d", &lo, &hi) == 2) {
+            for (int c = lo; c <= hi; ++c) cpus.push_back(c);
+        } else if (std::sscanf(part.c_str(), "%d", &lo) == 1) {
+            cpus.push_back(lo);
+        }
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    return cpus;
+}
+#endif
+
+// reads the NUMA nodes and their CPUs (one node with every allowed CPU if that fails)
+inline NumaTopology detectNumaTopology() {
+    NumaTopology topology;
+#if defined(_WIN32)
+    DWORD_PTR process_mask = 0, system_mask = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask);
+    ULONG highest = 0;
+    if (GetNumaHighestNodeNumber(&highest)) {
+        for (ULONG node = 0; node <= highest; ++node) {
+            ULONGLONG mask = 0;
+            if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask)) continue;
+            std::vector<int> cpus;
+            for (int c = 0; c < 64; ++c) {
+                if ((mask >> c) & (process_mask >> c) & 1) cpus.push_back(c);
+            }
+            if (!cpus.empty()) topology.node_cpus.push_back(cpus);
+        }
+    }
+    if (topology.node_cpus.empty()) {
+        std::vector<int> cpus;
+        for (int c = 0; c < 64; ++c) {
+            if ((process_mask >> c) & 1) cpus.push_back(c);
+        }
+        topology.node_cpus.push_back(cpus);
+    }
+#else
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    for (int node = 0; node < 1024; ++node) {
+        std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+        std::FILE* f = std::fopen(path.c_str(), "r");
+        if (!f) {
+            if (node > 0) break;
+            continue;
+        }
+        char line[4096] = {};
+        bool read = std::fgets(line, sizeof(line), f) != nullptr;
+        std::fclose(f);
+        if (!read) continue;
+        std::vector<int> cpus;
+        for (int c : parseCpuList(line)) {
+            if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        }
+        if (!cpus.empty()) topology.node_cpus.push_back(cpus);
+    }
+    if (topology.node_cpus.empty()) {
+        std::vector<int> cpus;
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        }
+        topology.node_cpus.push_back(cpus);
+    }
+#endif
+    return topology;
+}
+
+// pins the calling thread to one CPU, false if the OS said no
+inline bool pinCurrentThread(int cpu) {
+#if defined(_WIN32)
+    if (cpu >= 64) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
+
+class ThreadPlacement {
+public:
+    // works out which CPU each worker gets and says so
+    ThreadPlacement(const std::string& mode, long long worker_count) {
+        if (mode == "none") return;
+        if (mode != "compact" && mode != "spread") {
+            std::cerr << "Unknown AFFINITY '" << mode << "', not pinning threads." << std::endl;
+            return;
+        }
+        NumaTopology topology = detectNumaTopology();
+        std::vector<int> order;
+        if (mode == "compact") {
+            for (const std::vector<int>& cpus : topology.node_cpus) order.insert(order.end(), cpus.begin(), cpus.end());
+        } else {
+            // take the next CPU of each node in turn
+            for (std::size_t k = 0; order.size() < cpuCount(topology); ++k) {
+                for (const std::vector<int>& cpus : topology.node_cpus) {
+                    if (k < cpus.size()) order.push_back(cpus[k]);
+                }
+            }
+        }
+        if (order.empty()) return;
+
+        // more workers than CPUs wrap around
+        for (long long i = 0; i < worker_count; ++i) cpu_of_worker_.push_back(order[i % order.size()]);
+        std::cout << "Affinity: " << mode << " over " << topology.node_cpus.size() << " NUMA node(s), workers on CPUs";
+        for (int cpu : cpu_of_worker_) std::cout << " " << cpu;
+        std::cout << std::endl;
+    }
+
+    // called by worker `worker` as the first thing it does
+    void pin(int worker) const {
+        if (static_cast<std::size_t>(worker) < cpu_of_worker_.size() && !pinCurrentThread(cpu_of_worker_[worker])) {
+            std::cerr << "Could not pin worker " << worker << " to CPU " << cpu_of_worker_[worker] << std::endl;
+        }
+    }
+
+private:
+    static std::size_t cpuCount(const NumaTopology& topology) {
+        std::size_t count = 0;
+        for (const std::vector<int>& cpus : topology.node_cpus) count += cpus.size();
+        return count;
+    }
+
+    std::vector<int> cpu_of_worker_; // empty = no pinning
+};
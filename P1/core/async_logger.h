@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Asynchronous batched logger for the Immediate Print variants.
+// Each worker thread appends finished lines to its own single-producer
+// ring buffer (no lock, no flush). A dedicated writer thread drains all the
+// rings into one big batch and hands it to stdout with a single fwrite +
+// fflush, so worker threads never serialize on the console.
+//
+// Lines are formatted by the caller, so the timestamp and thread id still
+// reflect the moment and the thread that found the prime. Lines from one
+// thread stay in order; lines from different threads interleave per batch.
+class AsyncLogger {
+public:
+    explicit AsyncLogger(std::size_t per_thread_bytes = 64 * 1024, std::size_t batch_bytes = 1 << 20)
+        : batch_bytes_(batch_bytes), id_(next_id_.fetch_add(1) + 1) {
+        ring_bytes_ = 1024;
+        while (ring_bytes_ < per_thread_bytes) ring_bytes_ <<= 1;
+        batch_.reserve(batch_bytes_);
+    }
+
+    ~AsyncLogger() { stop(); }
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    void start() {
+        std::fflush(stdout);
+        running_.store(true);
+        writer_ = std::thread(&AsyncLogger::writerLoop, this);
+    }
+
+    // drains everything that was logged, then stops the writer thread
+    void stop() {
+        if (!writer_.joinable()) return;
+        running_.store(false);
+        writer_.join();
+    }
+
+    // called from worker threads; copies one line into this thread's ring
+    void append(const char* data, std::size_t len) {
+        ThreadBuffer& buf = localBuffer();
+        if (len > ring_bytes_) len = ring_bytes_; // never bigger than the ring
+
+        std::size_t head = buf.head.load(std::memory_order_relaxed);
+        // backpressure: wait for the writer if our ring is full
+        while (ring_bytes_ - (head - buf.tail.load(std::memory_order_acquire)) < len) {
+            std::this_thread::yield();
+        }
+
+        std::size_t mask = ring_bytes_ - 1;
+        std::size_t offset = head & mask;
+        std::size_t first = std::min(len, ring_bytes_ - offset);
+        std::memcpy(buf.data.get() + offset, data, first);
+        std::memcpy(buf.data.get(), data + first, len - first);
+        buf.head.store(head + len, std::memory_order_release);
+    }
+
+    void append(const std::string& line) { append(line.data(), line.size()); }
+
+private:
+    struct alignas(64) ThreadBuffer {
+        explicit ThreadBuffer(std::size_t bytes) : data(new char[bytes]) {}
+        std::unique_ptr<char[]> data;
+        alignas(64) std::atomic<std::size_t> head{0}; // advanced by the worker
+        alignas(64) std::atomic<std::size_t> tail{0}; // advanced by the writer
+    };
+
+    // The cache is keyed by the logger's id, not its address: pool threads
+    // outlive a run, and the next run's logger may sit at the same address.
+    ThreadBuffer& localBuffer() {
+        thread_local ThreadBuffer* tl_buffer = nullptr;
+        thread_local std::uint64_t tl_owner = 0;
+        if (tl_owner != id_) {
+            // first line from this thread: register a ring (the only lock a worker takes)
+            std::lock_guard<std::mutex> lock(registry_mutex_);
+            buffers_.push_back(std::make_unique<ThreadBuffer>(ring_bytes_));
+            tl_buffer = buffers_.back().get();
+            tl_owner = id_;
+        }
+        return *tl_buffer;
+    }
+
+    // moves everything currently in the rings into the batch and writes it out
+    bool drainOnce() {
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex_);
+            std::size_t mask = ring_bytes_ - 1;
+            for (auto& buf : buffers_) {
+                std::size_t tail = buf->tail.load(std::memory_order_relaxed);
+                std::size_t head = buf->head.load(std::memory_order_acquire);
+                while (tail != head) {
+                    std::size_t offset = tail & mask;
+                    std::size_t chunk = std::min(head - tail, ring_bytes_ - offset);
+                    if (batch_.size() + chunk > batch_bytes_) flushBatch();
+                    batch_.insert(batch_.end(), buf->data.get() + offset, buf->data.get() + offset + chunk);
+                    tail += chunk;
+                }
+                buf->tail.store(tail, std::memory_order_release);
+            }
+        }
+        if (batch_.empty()) return false;
+        flushBatch();
+        return true;
+    }
+
+    void flushBatch() {
+        if (batch_.empty()) return;
+        std::fwrite(batch_.data(), 1, batch_.size(), stdout);
+        std::fflush(stdout);
+        batch_.clear();
+    }
+
+    void writerLoop() {
+        while (running_.load()) {
+            if (!drainOnce()) {
+                // idle: check again shortly instead of making workers signal us
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        // workers are done - take whatever is left
+        while (drainOnce()) {
+        }
+    }
+
+    std::size_t ring_bytes_;
+    std::size_t batch_bytes_;
+    std::uint64_t id_; // unique per logger, never 0
+    static inline std::atomic<std::uint64_t> next_id_{0};
+    std::vector<char> batch_;
+    std::mutex registry_mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::atomic<bool> running_{false};
+    std::thread writer_;
+};
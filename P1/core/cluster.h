@@ -0,0 +1,462 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "net.h"
+#include "prime_file.h"
+#include "result_buffer.h"
+#include "segmented_sieve.h"
+#include "thread_pool.h"
+#include "timestamp.h"
+
+// Cluster mode: one coordinator process hands out [MIN_NUMBER, MAX_NUMBER]
+// in CLUSTER_SEGMENT_SIZE pieces to any number of worker processes over TCP.
+//   - each worker gets kSegmentsInFlight segments at a time, so it always has
+//     the next one queued while it sends back the last
+//   - a worker sieves its segment with THREAD_COUNT threads and sends the
+//     primes back already encoded the way the result file stores them
+//   - a worker that closes its connection, or is silent for WORKER_TIMEOUT
+//     seconds (workers heartbeat every second while they search), is dropped
+//     and its unfinished segments go back to the front of the queue
+//   - results arrive in any order; the coordinator keeps them until the
+//     segments before them are done and appends them to RESULT_FILE in order
+//
+// Protocol (frames from net.h, payloads are the structs below):
+//   worker -> coordinator: Hello, then Result per segment, Heartbeat
+//   coordinator -> worker: Welcome, Assign per segment, Done at the end
+
+enum ClusterMessage : std::uint32_t {
+    kClusterHello = 1,
+    kClusterWelcome = 2,
+    kClusterAssign = 3,
+    kClusterResult = 4,
+    kClusterHeartbeat = 5,
+    kClusterDone = 6,
+};
+
+constexpr std::uint32_t kClusterProtocolVersion = 1;
+
+struct ClusterHello {
+    std::uint32_t version;
+    std::uint32_t threads;
+};
+
+struct ClusterWelcome {
+    std::int64_t max_number;          // so the worker builds its base primes once
+    std::int64_t sieve_segment_size;
+};
+
+struct ClusterAssign {
+    std::uint64_t segment;
+    std::int64_t lo;
+    std::int64_t hi;
+};
+
+// followed by `bytes` bytes of encoded primes
+struct ClusterResult {
+    std::uint64_t segment;
+    std::int64_t lo;
+    std::int64_t hi;
+    std::uint64_t count;
+    std::uint64_t bytes;
+    std::uint64_t search_ns;          // time the worker spent searching
+    std::uint32_t encoding;           // SegmentEncoding
+    std::uint32_t reserved;
+};
+
+template <typename T>
+bool sendMessage(const Socket& s, ClusterMessage type, const T& body) {
+    return sendFrame(s, type, &body, sizeof(body));
+}
+
+template <typename T>
+bool readMessage(const Frame& frame, T& body) {
+    if (frame.payload.size() < sizeof(T)) return false;
+    std::memcpy(&body, frame.payload.data(), sizeof(T));
+    return true;
+}
+
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+class ClusterCoordinator {
+public:
+    static constexpr std::size_t kSegmentsInFlight = 2;
+
+    explicit ClusterCoordinator(const SearchSettings& settings) : settings_(settings) {
+        long long first = settings.min_number < 2 ? 2 : settings.min_number;
+        long long size = settings.cluster_segment_size < 1 ? 1 : settings.cluster_segment_size;
+        for (long long lo = first; lo <= settings.max_number; lo += size) {
+            long long hi = (settings.max_number - lo < size) ? settings.max_number : lo + size - 1;
+            segments_.push_back({lo, hi});
+            pending_.push_back(segments_.size() - 1);
+        }
+        done_.assign(segments_.size(), false);
+        first_ = first;
+    }
+
+    // serves workers until every segment is written; returns the exit code
+    int run() {
+        std::string error;
+        listener_ = listenTcp(static_cast<int>(settings_.cluster_port), error);
+        if (!listener_.valid()) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        if (!settings_.result_file.empty() && !writer_.open(settings_.result_file, first_)) {
+            std::cerr << "Error: Could not write result file " << settings_.result_file << std::endl;
+            return 1;
+        }
+        std::cout << "Coordinator: " << segments_.size() << " segments of up to " << settings_.cluster_segment_size
+                  << " numbers, listening on port " << settings_.cluster_port << std::endl;
+
+        std::vector<SocketHandle> handles;
+        std::vector<bool> ready;
+        while (written_ < segments_.size()) {
+            handles.assign(1, listener_.handle());
+            for (const auto& c : connections_) handles.push_back(c->socket.handle());
+            if (!waitReadable(handles, 200, ready)) {
+                std::cerr << "Error: poll failed" << std::endl;
+                return 1;
+            }
+            if (ready[0]) acceptWorker();
+            // ready[] lines up with connections_ as it was before the accept
+            for (std::size_t i = 0; i + 1 < ready.size(); ++i) {
+                if (ready[i + 1]) serve(*connections_[i]);
+            }
+            dropDeadWorkers();
+            assignSegments();
+        }
+
+        for (const auto& c : connections_) sendFrame(c->socket, kClusterDone, nullptr, 0);
+        bool ok = settings_.result_file.empty() || writer_.finish();
+        printSummary(ok);
+        return ok ? 0 : 1;
+    }
+
+private:
+    struct Range {
+        long long lo;
+        long long hi;
+    };
+
+    struct Connection {
+        int id = 0;
+        std::string peer;
+        Socket socket;
+        FrameReader reader;
+        bool joined = false;              // Hello received
+        bool dead = false;
+        std::string why_dead;
+        std::uint32_t threads = 0;
+        std::vector<std::size_t> in_flight;
+        std::chrono::steady_clock::time_point last_heard;
+    };
+
+    struct WorkerTotals {
+        int id;
+        std::string peer;
+        std::uint32_t threads;
+        long long segments = 0;
+        long long numbers = 0;
+        double search_seconds = 0;
+        bool lost = false;
+    };
+
+    struct Finished {
+        std::uint64_t count;
+        SegmentEncoding encoding;
+        std::vector<std::uint8_t> data;
+    };
+
+    void acceptWorker() {
+        std::string peer;
+        Socket s = acceptTcp(listener_, peer);
+        if (!s.valid()) return;
+        auto c = std::make_unique<Connection>();
+        c->id = next_id_++;
+        c->peer = peer;
+        c->socket = std::move(s);
+        c->last_heard = std::chrono::steady_clock::now();
+        connections_.push_back(std::move(c));
+    }
+
+    // reads what the worker sent and handles every complete message
+    void serve(Connection& c) {
+        if (c.dead) return;
+        if (!c.reader.readAvailable(c.socket)) {
+            markDead(c, "connection closed");
+            return;
+        }
+        c.last_heard = std::chrono::steady_clock::now();
+        Frame frame;
+        bool bad = false;
+        while (!c.dead && c.reader.next(frame, bad)) handle(c, frame);
+        if (bad) markDead(c, "bad message");
+    }
+
+    void handle(Connection& c, const Frame& frame) {
+        if (frame.type == kClusterHello) {
+            ClusterHello hello;
+            if (!readMessage(frame, hello) || hello.version != kClusterProtocolVersion) {
+                markDead(c, "wrong protocol version");
+                return;
+            }
+            c.joined = true;
+            c.threads = hello.threads;
+            totals_[c.id] = {c.id, c.peer, hello.threads};
+            ClusterWelcome welcome = {settings_.max_number, settings_.sieve_segment_size};
+            if (!sendMessage(c.socket, kClusterWelcome, welcome)) markDead(c, "send failed");
+            std::cout << "Worker " << c.id << " joined from " << c.peer << " (" << c.threads << " threads)" << std::endl;
+        } else if (frame.type == kClusterResult) {
+            ClusterResult result;
+            if (!c.joined || !readMessage(frame, result) || frame.payload.size() != sizeof(result) + result.bytes ||
+                result.segment >= segments_.size()) {
+                markDead(c, "bad result");
+                return;
+            }
+            for (std::size_t k = 0; k < c.in_flight.size(); ++k) {
+                if (c.in_flight[k] == result.segment) {
+                    c.in_flight.erase(c.in_flight.begin() + static_cast<std::ptrdiff_t>(k));
+                    break;
+                }
+            }
+            if (done_[result.segment]) return; // a reassigned segment finished twice
+            done_[result.segment] = true;
+            WorkerTotals& t = totals_[c.id];
+            ++t.segments;
+            t.numbers += result.hi - result.lo + 1;
+            t.search_seconds += result.search_ns / 1e9;
+            const std::uint8_t* data = frame.payload.data() + sizeof(result);
+            finished_[result.segment] = {result.count, static_cast<SegmentEncoding>(result.encoding),
+                                         std::vector<std::uint8_t>(data, data + result.bytes)};
+            writeFinished();
+        }
+        // heartbeats only refresh last_heard
+    }
+
+    void markDead(Connection& c, const std::string& why) {
+        if (c.dead) return;
+        c.dead = true;
+        c.why_dead = why;
+    }
+
+    // requeues the segments of every dead or silent worker and drops it
+    void dropDeadWorkers() {
+        auto now = std::chrono::steady_clock::now();
+        for (const auto& c : connections_) {
+            if (!c->dead && now - c->last_heard > std::chrono::seconds(settings_.worker_timeout)) {
+                markDead(*c, "silent for " + std::to_string(settings_.worker_timeout) + " s");
+            }
+        }
+        for (std::size_t i = 0; i < connections_.size();) {
+            Connection& c = *connections_[i];
+            if (!c.dead) {
+                ++i;
+                continue;
+            }
+            // back to the front, in order, so the writer isn't held up for long
+            for (auto it = c.in_flight.rbegin(); it != c.in_flight.rend(); ++it) pending_.push_front(*it);
+            std::cout << "Worker " << c.id << " lost (" << c.why_dead << ")";
+            if (!c.in_flight.empty()) std::cout << ", reassigning " << c.in_flight.size() << " segment(s)";
+            std::cout << std::endl;
+            reassigned_ += static_cast<long long>(c.in_flight.size());
+            if (c.joined) totals_[c.id].lost = true;
+            connections_.erase(connections_.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+    }
+
+    void assignSegments() {
+        for (const auto& c : connections_) {
+            while (c->joined && !c->dead && c->in_flight.size() < kSegmentsInFlight && !pending_.empty()) {
+                std::size_t segment = pending_.front();
+                pending_.pop_front();
+                ClusterAssign assign = {segment, segments_[segment].lo, segments_[segment].hi};
+                c->in_flight.push_back(segment);
+                if (!sendMessage(c->socket, kClusterAssign, assign)) markDead(*c, "send failed");
+            }
+        }
+    }
+
+    // writes every finished segment that is next in line
+    void writeFinished() {
+        while (written_ < segments_.size()) {
+            auto it = finished_.find(written_);
+            if (it == finished_.end()) break;
+            const Finished& f = it->second;
+            if (!settings_.result_file.empty() &&
+                !writer_.addEncodedSegment(segments_[written_].lo, segments_[written_].hi, f.count, f.encoding,
+                                           f.data.data(), f.data.size())) {
+                write_ok_ = false;
+            }
+            total_primes_ += f.count;
+            finished_.erase(it);
+            ++written_;
+            // a progress line every 10%
+            std::size_t tenth = written_ * 10 / segments_.size();
+            if (tenth > progress_tenths_) {
+                progress_tenths_ = tenth;
+                std::cout << "Progress: " << tenth * 10 << "% (" << written_ << "/" << segments_.size() << " segments, "
+                          << total_primes_ << " primes)" << std::endl;
+            }
+        }
+    }
+
+    void printSummary(bool ok) {
+        double seconds = secondsSince(start_);
+        long long numbers = settings_.max_number - first_ + 1;
+        std::cout << "Found " << total_primes_ << " primes in [" << first_ << ", " << settings_.max_number << "]" << std::endl;
+        for (const auto& entry : totals_) {
+            const WorkerTotals& t = entry.second;
+            std::cout << "Worker " << t.id << " (" << t.peer << ", " << t.threads << " threads): " << t.segments
+                      << " segments, " << t.numbers << " numbers";
+            if (t.search_seconds > 0) std::cout << ", " << static_cast<long long>(t.numbers / t.search_seconds) << " numbers/s";
+            if (t.lost) std::cout << " (lost)";
+            std::cout << std::endl;
+        }
+        if (reassigned_) std::cout << "Reassigned segments: " << reassigned_ << std::endl;
+        if (!settings_.result_file.empty()) printResultFile(ok && write_ok_);
+        std::cout << "Run END: " << getCurrentTimestamp() << std::endl;
+        std::cout << "Total execution time: " << static_cast<long long>(seconds * 1000) << " ms" << std::endl;
+        std::cout << "Aggregate throughput: " << static_cast<long long>(seconds > 0 ? numbers / seconds : 0)
+                  << " numbers/s over " << totals_.size() << " worker(s)" << std::endl;
+    }
+
+    void printResultFile(bool ok) {
+        if (!ok) {
+            std::cerr << "Error: Could not write result file " << settings_.result_file << std::endl;
+            return;
+        }
+        std::cout << "Result file: " << settings_.result_file << " (" << writer_.segmentCount() << " segments, "
+                  << writer_.fileBytes() << " bytes)" << std::endl;
+    }
+
+    SearchSettings settings_;
+    long long first_ = 2;
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+    Socket listener_;
+    std::vector<std::unique_ptr<Connection>> connections_;
+    std::map<int, WorkerTotals> totals_;           // every worker that ever joined, by id
+    int next_id_ = 1;
+
+    std::vector<Range> segments_;
+    std::deque<std::size_t> pending_;              // not assigned to anyone right now
+    std::vector<bool> done_;
+    std::map<std::size_t, Finished> finished_;     // done but waiting for earlier segments
+    std::size_t written_ = 0;                      // segments [0, written_) are in the file
+    std::size_t progress_tenths_ = 0;
+    std::uint64_t total_primes_ = 0;
+    long long reassigned_ = 0;
+    bool write_ok_ = true;
+    PrimeFileWriter writer_;
+};
+
+class ClusterWorker {
+public:
+    explicit ClusterWorker(const SearchSettings& settings) : settings_(settings) {}
+
+    // connects to the coordinator and searches segments until it says Done
+    int run(const std::string& host) {
+        std::string error;
+        Socket s;
+        // the coordinator may still be starting up
+        for (int attempt = 0; attempt < 20 && !s.valid(); ++attempt) {
+            if (attempt) std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            s = connectTcp(host, static_cast<int>(settings_.cluster_port), error);
+        }
+        if (!s.valid()) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+
+        long long threads = settings_.thread_count < 1 ? 1 : settings_.thread_count;
+        ClusterHello hello = {kClusterProtocolVersion, static_cast<std::uint32_t>(threads)};
+        Frame frame;
+        ClusterWelcome welcome;
+        if (!sendMessage(s, kClusterHello, hello) || !receiveFrame(s, frame) || frame.type != kClusterWelcome ||
+            !readMessage(frame, welcome)) {
+            std::cerr << "Error: The coordinator did not answer" << std::endl;
+            return 1;
+        }
+        std::cout << "Connected to " << host << ":" << settings_.cluster_port << ", searching with " << threads
+                  << " threads" << std::endl;
+
+        SegmentedSieve sieve(welcome.max_number, static_cast<std::size_t>(welcome.sieve_segment_size));
+        ThreadPool pool(static_cast<std::size_t>(threads));
+        PrimeSegmentEncoder encoder;
+        long long segments = 0;
+        while (receiveFrame(s, frame)) {
+            if (frame.type == kClusterDone) {
+                std::cout << "Done after " << segments << " segments" << std::endl;
+                return 0;
+            }
+            ClusterAssign assign;
+            if (frame.type != kClusterAssign || !readMessage(frame, assign)) continue;
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<long long> primes;
+            if (!search(s, sieve, pool, threads, assign.lo, assign.hi, primes)) break;
+            ClusterResult result;
+            std::memset(&result, 0, sizeof(result));
+            result.search_ns = static_cast<std::uint64_t>(secondsSince(start) * 1e9);
+
+            SegmentEncoding encoding;
+            const std::vector<std::uint8_t>& data = encoder.encode(assign.lo, assign.hi, primes.data(), primes.size(), encoding);
+            result.segment = assign.segment;
+            result.lo = assign.lo;
+            result.hi = assign.hi;
+            result.count = primes.size();
+            result.bytes = data.size();
+            result.encoding = static_cast<std::uint32_t>(encoding);
+            std::vector<std::uint8_t> payload(sizeof(result) + data.size());
+            std::memcpy(payload.data(), &result, sizeof(result));
+            if (!data.empty()) std::memcpy(payload.data() + sizeof(result), data.data(), data.size());
+            if (!sendFrame(s, kClusterResult, payload.data(), static_cast<std::uint32_t>(payload.size()))) break;
+            ++segments;
+        }
+        std::cerr << "Error: Lost the coordinator after " << segments << " segments" << std::endl;
+        return 1;
+    }
+
+private:
+    // sieves [lo, hi] in one slice per thread, heartbeating while it waits
+    static bool search(const Socket& s, const SegmentedSieve& sieve, ThreadPool& pool, long long threads,
+                       long long lo, long long hi, std::vector<long long>& primes) {
+        std::vector<std::future<std::vector<long long>>> slices;
+        long long span = hi - lo + 1;
+        for (long long i = 0; i < threads; ++i) {
+            long long slice_lo = lo + span * i / threads;
+            long long slice_hi = lo + span * (i + 1) / threads - 1;
+            slices.push_back(pool.submit([&sieve, slice_lo, slice_hi] {
+                std::vector<long long> found;
+                found.reserve(primesInRangeEstimate(slice_lo, slice_hi));
+                sieve.forEachPrime(slice_lo, slice_hi, [&found](long long p) { found.push_back(p); });
+                return found;
+            }));
+        }
+        bool alive = true;
+        for (auto& slice : slices) {
+            while (slice.wait_for(std::chrono::seconds(1)) != std::future_status::ready) {
+                alive = alive && sendFrame(s, kClusterHeartbeat, nullptr, 0);
+            }
+            std::vector<long long> found = slice.get();
+            primes.insert(primes.end(), found.begin(), found.end());
+        }
+        return alive;
+    }
+
+    SearchSettings settings_;
+};
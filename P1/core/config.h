@@ -0,0 +1,344 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "primality.h"
+#include "segmented_sieve.h"
+#include "wheel.h"
+
+// every knob a prime search run understands (see Build Intructions.txt)
+struct SearchSettings {
+    long long thread_count = 0;
+    long long max_number = 0;
+    long long min_number = 2;                        // lower limit (inclusive), for spot checks of big ranges
+
+    // per-number test
+    std::string primality = "auto";                  // auto | trial | miller-rabin
+    long long miller_rabin_threshold = kDefaultMillerRabinThreshold;
+    std::string simd = "auto";                       // auto | off | scalar | avx2 | avx512 | neon
+    long long wheel = Wheel::kDefaultModulus;        // candidate wheel: 1 (off), 2, 6, 30, 210 or 2310
+
+    // range division
+    std::string algorithm = "trial";                 // trial | sieve
+    long long sieve_segment_size = kDefaultSegmentBytes;
+    std::string range_split = "equal";               // equal | cost | dynamic
+    long long range_chunk = 4096;                    // numbers per claim when RANGE_SPLIT=dynamic
+
+    // number division
+    std::string scheduler = "queue";                 // queue | stealing | ring
+    long long chunk_size = 1024;
+    long long queue_capacity = 1024;
+
+    // immediate print
+    std::string logger = "direct";                   // direct | async
+
+    // batched print
+    std::string result_storage = "raw";              // raw | delta32 | bitset
+    std::string batch_output = "all";                // all | stream
+    long long stream_segment_size = 1 << 20;         // numbers per streamed segment
+    long long stream_in_flight = 0;                  // 0 = twice the thread count
+    std::string result_file;                         // binary result file (core/prime_file.h), empty = none
+    std::string cache_file;                          // persistent sieve cache (core/sieve_cache.h), empty = none
+
+    // worker threads
+    std::string affinity = "none";                   // none | compact | spread (core/affinity.h)
+    std::string thread_pool = "off";                 // off | on: reuse the shared pool (core/thread_pool.h)
+
+    // cluster mode (core/cluster.h)
+    long long cluster_port = 5150;                   // coordinator TCP port
+    long long cluster_segment_size = 1 << 24;        // numbers per segment handed to a worker
+    long long worker_timeout = 10;                   // seconds of silence before a worker counts as dead
+
+    // instrumentation
+    std::string instrument = "off";                  // off | summary | trace
+    std::string trace_file = "prime_trace.json";     // Chrome trace output for INSTRUMENT=trace
+};
+
+// Settings come from three places, later ones win:
+//   1. the config file (KEY=value lines, ';' starts a comment)
+//   2. environment variables P1_<KEY>, e.g. P1_THREAD_COUNT=8
+//   3. command line flags --KEY=value (also --thread-count=8, any case)
+// --config=<path> (or P1_CONFIG, or a bare path argument) picks the file;
+// --config= with nothing after it skips the file altogether.
+// The file is read into a fixed buffer and parsed in place, so loading the
+// settings doesn't allocate (apart from the text values themselves).
+
+// one config key and the SearchSettings field it sets (exactly one of the two)
+struct SettingKey {
+    const char* name;
+    long long SearchSettings::*number;
+    std::string SearchSettings::*text;
+};
+
+inline constexpr SettingKey kSettingKeys[] = {
+    {"THREAD_COUNT", &SearchSettings::thread_count, nullptr},
+    {"MAX_NUMBER", &SearchSettings::max_number, nullptr},
+    {"MIN_NUMBER", &SearchSettings::min_number, nullptr},
+    {"PRIMALITY", nullptr, &SearchSettings::primality},
+    {"MILLER_RABIN_THRESHOLD", &SearchSettings::miller_rabin_threshold, nullptr},
+    {"SIMD", nullptr, &SearchSettings::simd},
+    {"WHEEL", &SearchSettings::wheel, nullptr},
+    {"ALGORITHM", nullptr, &SearchSettings::algorithm},
+    {"SIEVE_SEGMENT_SIZE", &SearchSettings::sieve_segment_size, nullptr},
+    {"RANGE_SPLIT", nullptr, &SearchSettings::range_split},
+    {"RANGE_CHUNK", &SearchSettings::range_chunk, nullptr},
+    {"SCHEDULER", nullptr, &SearchSettings::scheduler},
+    {"CHUNK_SIZE", &SearchSettings::chunk_size, nullptr},
+    {"QUEUE_CAPACITY", &SearchSettings::queue_capacity, nullptr},
+    {"LOGGER", nullptr, &SearchSettings::logger},
+    {"RESULT_STORAGE", nullptr, &SearchSettings::result_storage},
+    {"BATCH_OUTPUT", nullptr, &SearchSettings::batch_output},
+    {"STREAM_SEGMENT_SIZE", &SearchSettings::stream_segment_size, nullptr},
+    {"STREAM_IN_FLIGHT", &SearchSettings::stream_in_flight, nullptr},
+    {"RESULT_FILE", nullptr, &SearchSettings::result_file},
+    {"CACHE_FILE", nullptr, &SearchSettings::cache_file},
+    {"AFFINITY", nullptr, &SearchSettings::affinity},
+    {"THREAD_POOL", nullptr, &SearchSettings::thread_pool},
+    {"CLUSTER_PORT", &SearchSettings::cluster_port, nullptr},
+    {"CLUSTER_SEGMENT_SIZE", &SearchSettings::cluster_segment_size, nullptr},
+    {"WORKER_TIMEOUT", &SearchSettings::worker_timeout, nullptr},
+    {"INSTRUMENT", nullptr, &SearchSettings::instrument},
+    {"TRACE_FILE", nullptr, &SearchSettings::trace_file},
+};
+
+// config files bigger than this are rejected (the shipped ones are ~2 KiB)
+constexpr std::size_t kMaxConfigBytes = 64 * 1024;
+
+inline std::string_view trimConfigText(std::string_view text) {
+    std::size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos) return {};
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+// true if all of text is one integer
+inline bool parseConfigNumber(std::string_view text, long long& value) {
+    if (!text.empty() && text[0] == '+') text.remove_prefix(1);
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+// calls fn(key, value) for every KEY=value line of text, both trimmed
+template <typename Fn>
+void forEachConfigLine(std::string_view text, Fn&& fn) {
+    while (!text.empty()) {
+        std::size_t newline = text.find('\n');
+        std::string_view line = text.substr(0, newline);
+        text = (newline == std::string_view::npos) ? std::string_view() : text.substr(newline + 1);
+        // Ignore comments and empty lines
+        if (line.empty() || line[0] == ';') continue;
+        std::size_t equals = line.find('=');
+        if (equals == std::string_view::npos) continue;
+        fn(trimConfigText(line.substr(0, equals)), trimConfigText(line.substr(equals + 1)));
+    }
+}
+
+// reads the whole file into buffer (no allocation), false if it can't
+inline bool readConfigFile(const std::string& path, char (&buffer)[kMaxConfigBytes], std::string_view& text) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return false;
+    }
+    std::size_t size = std::fread(buffer, 1, kMaxConfigBytes, f);
+    bool too_big = (size == kMaxConfigBytes) && std::fgetc(f) != EOF;
+    std::fclose(f);
+    if (too_big) {
+        std::cerr << "Error: " << path << " is bigger than " << kMaxConfigBytes << " bytes" << std::endl;
+        return false;
+    }
+    text = std::string_view(buffer, size);
+    return true;
+}
+
+inline const SettingKey* findSettingKey(std::string_view key) {
+    for (const SettingKey& k : kSettingKeys) {
+        if (key == k.name) return &k;
+    }
+    return nullptr;
+}
+
+// sets one key; unknown keys are left alone (the bench and cluster add their own)
+inline bool applySetting(SearchSettings& settings, std::string_view key, std::string_view value) {
+    const SettingKey* k = findSettingKey(key);
+    if (!k) return false;
+    if (k->text) {
+        (settings.*k->text).assign(value.data(), value.size());
+        return true;
+    }
+    long long number;
+    if (!parseConfigNumber(value, number)) {
+        std::cerr << "Error: " << k->name << " needs a number, ignoring '" << value << "'" << std::endl;
+        return false;
+    }
+    settings.*k->number = number;
+    return true;
+}
+
+// reads the config file and puts values in a map
+// (for tools with keys of their own, like the benchmark's lists).
+// numeric values go into config, anything else (e.g. ALGORITHM=sieve) into text_config.
+inline bool loadConfig(const std::string& path, std::map<std::string, long long>& config,
+                       std::map<std::string, std::string>& text_config) {
+    static char buffer[kMaxConfigBytes];
+    std::string_view text;
+    if (!readConfigFile(path, buffer, text)) return false;
+    forEachConfigLine(text, [&](std::string_view key, std::string_view value) {
+        long long number;
+        // not a number (or a list like 1,2,4): keep it as text
+        if (parseConfigNumber(value, number)) config[std::string(key)] = number;
+        else text_config[std::string(key)] = std::string(value);
+    });
+    return true;
+}
+
+// copies every key that is present into settings (missing ones keep their value)
+inline void applySettings(std::map<std::string, long long>& config, std::map<std::string, std::string>& text_config,
+                          SearchSettings& settings) {
+    for (const SettingKey& k : kSettingKeys) {
+        if (k.number && config.count(k.name)) settings.*k.number = config[k.name];
+        if (k.text && text_config.count(k.name)) settings.*k.text = text_config[k.name];
+    }
+}
+
+// Optional fixed build: compile with -DP1_FIXED_THREAD_COUNT=8 and/or
+// -DP1_FIXED_ALGORITHM=Sieve (or Trial) and the partition policies get
+// them as template parameters, so the worker loops and the range kernel are
+// specialized for them (see partition_policy.h). The config can't change
+// them any more; a different value there is overridden with a note.
+enum class FixedAlgorithm { Runtime, Trial, Sieve };
+
+#ifdef P1_FIXED_THREAD_COUNT
+constexpr long long kFixedThreadCount = P1_FIXED_THREAD_COUNT;
+static_assert(kFixedThreadCount >= 1, "P1_FIXED_THREAD_COUNT must be at least 1");
+#else
+constexpr long long kFixedThreadCount = 0; // read THREAD_COUNT at runtime
+#endif
+
+#ifdef P1_FIXED_ALGORITHM
+constexpr FixedAlgorithm kFixedAlgorithm = FixedAlgorithm::P1_FIXED_ALGORITHM;
+#else
+constexpr FixedAlgorithm kFixedAlgorithm = FixedAlgorithm::Runtime;
+#endif
+
+constexpr bool kFixedBuild = kFixedThreadCount > 0 || kFixedAlgorithm != FixedAlgorithm::Runtime;
+
+inline bool matchesFixedBuild(const SearchSettings& settings) {
+    if (kFixedThreadCount > 0 && settings.thread_count != kFixedThreadCount) return false;
+    if (kFixedAlgorithm == FixedAlgorithm::Trial && settings.algorithm != "trial") return false;
+    if (kFixedAlgorithm == FixedAlgorithm::Sieve && settings.algorithm != "sieve") return false;
+    return true;
+}
+
+// puts the built-in THREAD_COUNT / ALGORITHM into settings
+inline void applyFixedBuild(SearchSettings& settings) {
+    if (kFixedThreadCount > 0 && settings.thread_count != kFixedThreadCount) {
+        if (settings.thread_count > 0) {
+            std::cerr << "THREAD_COUNT is fixed at " << kFixedThreadCount << " in this build, ignoring "
+                      << settings.thread_count << "." << std::endl;
+        }
+        settings.thread_count = kFixedThreadCount;
+    }
+    if (kFixedAlgorithm != FixedAlgorithm::Runtime) {
+        const char* fixed = (kFixedAlgorithm == FixedAlgorithm::Sieve) ? "sieve" : "trial";
+        if (settings.algorithm != fixed) {
+            std::cerr << "ALGORITHM is fixed at " << fixed << " in this build, ignoring " << settings.algorithm << "." << std::endl;
+            settings.algorithm = fixed;
+        }
+    }
+}
+
+// "--thread-count" / "THREAD_COUNT" / "thread_count" -> "THREAD_COUNT", in out
+inline std::string_view normalizeFlagName(std::string_view flag, char (&out)[64]) {
+    while (!flag.empty() && flag[0] == '-') flag.remove_prefix(1);
+    if (flag.size() > sizeof(out)) return {};
+    for (std::size_t i = 0; i < flag.size(); ++i) {
+        char c = flag[i];
+        out[i] = (c == '-') ? '_' : (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+    }
+    return std::string_view(out, flag.size());
+}
+
+// Loads the settings from all three places (see above); default_path is the
+// config file used when neither --config nor P1_CONFIG names one.
+// False if an argument is wrong, the file can't be read, or THREAD_COUNT /
+// MAX_NUMBER ended up missing.
+inline bool loadSettings(int argc, char* argv[], const std::string& default_path, SearchSettings& settings) {
+    bool have_threads = kFixedThreadCount > 0;
+    bool have_max = false;
+    auto note = [&](std::string_view key) {
+        have_threads = have_threads || key == "THREAD_COUNT";
+        have_max = have_max || key == "MAX_NUMBER";
+    };
+
+    // which file: --config=... or a bare path beats P1_CONFIG beats the default
+    std::string path = default_path;
+    if (const char* env = std::getenv("P1_CONFIG")) path = env;
+    char name[64];
+    for (int i = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        std::size_t equals = arg.find('=');
+        if (equals == std::string_view::npos && arg.rfind("--", 0) != 0) path = std::string(arg);
+        else if (equals != std::string_view::npos && normalizeFlagName(arg.substr(0, equals), name) == "CONFIG") {
+            path = std::string(arg.substr(equals + 1));
+        }
+    }
+
+    // 1. the file
+    if (!path.empty()) {
+        static char buffer[kMaxConfigBytes];
+        std::string_view text;
+        if (!readConfigFile(path, buffer, text)) return false;
+        forEachConfigLine(text, [&](std::string_view key, std::string_view value) {
+            if (applySetting(settings, key, value)) note(key);
+        });
+    }
+
+    // 2. environment variables
+    for (const SettingKey& k : kSettingKeys) {
+        char env_name[64];
+        std::snprintf(env_name, sizeof(env_name), "P1_%s", k.name);
+        if (const char* value = std::getenv(env_name)) {
+            if (applySetting(settings, k.name, value)) note(k.name);
+        }
+    }
+
+    // 3. command line flags
+    for (int i = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        std::size_t equals = arg.find('=');
+        if (equals == std::string_view::npos) {
+            if (arg.rfind("--", 0) != 0) continue; // the config path
+            std::cerr << "Error: Option " << arg << " needs a value (" << arg << "=...)" << std::endl;
+            return false;
+        }
+        std::string_view key = normalizeFlagName(arg.substr(0, equals), name);
+        if (key == "CONFIG") continue;
+        if (!findSettingKey(key)) {
+            std::cerr << "Error: Unknown option " << arg.substr(0, equals) << std::endl;
+            return false;
+        }
+        if (!applySetting(settings, key, arg.substr(equals + 1))) return false;
+        note(key);
+    }
+
+    if (kFixedBuild) applyFixedBuild(settings);
+    if (!have_threads || !have_max) {
+        std::cerr << "Error: THREAD_COUNT and MAX_NUMBER must be set (config file, P1_<KEY> or --KEY=value)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// loads the settings from just a config file (plus P1_<KEY> environment variables)
+inline bool loadSettings(const std::string& path, SearchSettings& settings) {
+    return loadSettings(0, nullptr, path, settings);
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "config.h"
+
+// Per-run instrumentation (INSTRUMENT=summary or trace), to see where the
+// worker threads' time goes:
+//   - candidates looked at and primes found
+//   - time spent waiting for work (queue mutex + cv, ring, stealing deques,
+//     the streaming window) vs. computing
+//   - time blocked on the cout mutex (immediate print)
+//   - how much work and how many cv notifications the producer in main issued
+// Every worker only writes its own cache-line aligned slot, so counting adds
+// no sharing between threads. When INSTRUMENT=off (the default) every hook is
+// a single predictable branch.
+//
+// With INSTRUMENT=trace the wait/work spans are also written as Chrome trace
+// JSON (open it in chrome://tracing or ui.perfetto.dev).
+
+class Instrumentation {
+public:
+    // the run's instrumentation (one search runs at a time)
+    static Instrumentation& get() {
+        static Instrumentation instance;
+        return instance;
+    }
+
+    static std::int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // resets everything for a new run
+    void begin(const SearchSettings& settings) {
+        enabled_ = tracing_ = false;
+        if (settings.instrument == "summary") {
+            enabled_ = true;
+        } else if (settings.instrument == "trace") {
+            enabled_ = tracing_ = true;
+        } else if (settings.instrument != "off") {
+            std::cerr << "Unknown INSTRUMENT '" << settings.instrument << "', instrumentation is off." << std::endl;
+        }
+        trace_file_ = settings.trace_file;
+        workers_.assign(static_cast<std::size_t>(settings.thread_count > 0 ? settings.thread_count : 0), WorkerStats());
+        producer_ = ProducerStats();
+        origin_ns_ = nowNs();
+        if (enabled_) {
+            std::cout << "Instrumentation: " << settings.instrument;
+            if (tracing_) std::cout << " (trace to " << trace_file_ << ")";
+            std::cout << std::endl;
+        }
+    }
+
+    bool enabled() const { return enabled_; }
+
+    // --- worker side (only ever touches the worker's own slot) ---
+    // callers only take timestamps for the add*Wait/addWork hooks when enabled()
+
+    void workerStart(int worker) {
+        if (enabled_) workers_[worker].start_ns = nowNs();
+    }
+    void workerEnd(int worker) {
+        if (enabled_) workers_[worker].end_ns = nowNs();
+    }
+    void addCandidates(int worker, long long n) {
+        if (enabled_) workers_[worker].candidates += n;
+    }
+    void addPrimes(int worker, long long n) {
+        if (enabled_) workers_[worker].primes += n;
+    }
+    // waited from start to end for work (queue, ring, deque, stream window)
+    void addWait(int worker, std::int64_t start, std::int64_t end) {
+        WorkerStats& w = workers_[worker];
+        w.wait_ns += end - start;
+        if (tracing_ && end - start >= kTraceMinSpanNs) w.trace(kWaitName, start, end);
+    }
+    // was blocked on the cout mutex from start to end
+    void addCoutWait(int worker, std::int64_t start, std::int64_t end) {
+        WorkerStats& w = workers_[worker];
+        w.cout_wait_ns += end - start;
+        if (tracing_ && end - start >= kTraceMinSpanNs) w.trace(kCoutWaitName, start, end);
+    }
+    // trace-only span for a block of work (a range, a segment, a chunk)
+    void addWork(int worker, std::int64_t start, std::int64_t end) {
+        if (tracing_) workers_[worker].trace(kWorkName, start, end);
+    }
+
+    // --- producer side (main thread) ---
+
+    void addProducerItems(long long n) {
+        if (enabled_) producer_.items += n;
+    }
+    void addProducerNotifies(long long n) {
+        if (enabled_) producer_.notifies += n;
+    }
+    void producerSpan(std::int64_t start, std::int64_t end) {
+        if (enabled_) {
+            producer_.start_ns = start;
+            producer_.end_ns = end;
+        }
+    }
+
+    // per-thread table plus the producer line, and the trace file if asked for
+    void printSummary() {
+        if (!enabled_) return;
+        std::cout << "--- Instrumentation ---" << std::endl;
+        std::cout << std::left << std::setw(8) << "Thread" << std::setw(14) << "Candidates" << std::setw(10) << "Primes"
+                  << std::setw(13) << "Compute ms" << std::setw(13) << "Wait ms" << "Cout wait ms" << std::endl;
+        std::cout << std::fixed << std::setprecision(3);
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+            const WorkerStats& w = workers_[i];
+            std::int64_t total = (w.end_ns > w.start_ns) ? w.end_ns - w.start_ns : 0;
+            std::int64_t compute = total - w.wait_ns - w.cout_wait_ns;
+            if (compute < 0) compute = 0;
+            std::cout << std::setw(8) << i << std::setw(14) << w.candidates << std::setw(10) << w.primes
+                      << std::setw(13) << compute / 1e6 << std::setw(13) << w.wait_ns / 1e6 << w.cout_wait_ns / 1e6 << std::endl;
+        }
+        if (producer_.items > 0) {
+            std::cout << "Producer: " << producer_.items << " items, " << producer_.notifies << " notifications in "
+                      << (producer_.end_ns - producer_.start_ns) / 1e6 << " ms" << std::endl;
+        }
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::right << std::setprecision(6);
+        if (tracing_) writeTrace();
+    }
+
+private:
+    static constexpr const char* kWaitName = "wait for work";
+    static constexpr const char* kCoutWaitName = "cout mutex";
+    static constexpr const char* kWorkName = "work";
+    static constexpr std::int64_t kTraceMinSpanNs = 1000;  // shorter waits are only counted, not traced
+    static constexpr std::size_t kMaxTraceEvents = 1 << 16; // per thread
+
+    struct TraceEvent {
+        const char* name;
+        std::int64_t start_ns;
+        std::int64_t end_ns;
+    };
+
+    struct alignas(64) WorkerStats {
+        long long candidates = 0;
+        long long primes = 0;
+        std::int64_t wait_ns = 0;
+        std::int64_t cout_wait_ns = 0;
+        std::int64_t start_ns = 0;
+        std::int64_t end_ns = 0;
+        std::vector<TraceEvent> events;
+        long long dropped = 0;
+
+        void trace(const char* name, std::int64_t start, std::int64_t end) {
+            if (events.size() < kMaxTraceEvents) events.push_back({name, start, end});
+            else ++dropped;
+        }
+    };
+
+    struct ProducerStats {
+        long long items = 0;
+        long long notifies = 0;
+        std::int64_t start_ns = 0;
+        std::int64_t end_ns = 0;
+    };
+
+    void writeEvent(std::ofstream& out, bool& first, const char* name, int tid, std::int64_t start, std::int64_t end) {
+        out << (first ? "" : ",\n") << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+            << ",\"ts\":" << (start - origin_ns_) / 1e3 << ",\"dur\":" << (end - start) / 1e3 << "}";
+        first = false;
+    }
+
+    void writeThreadName(std::ofstream& out, bool& first, int tid, const std::string& name) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+            << ",\"args\":{\"name\":\"" << name << "\"}}";
+        first = false;
+    }
+
+    // Chrome trace format: main is tid 0, worker i is tid i + 1
+    void writeTrace() {
+        std::ofstream out(trace_file_);
+        if (!out.is_open()) {
+            std::cerr << "Error: Could not write trace file " << trace_file_ << std::endl;
+            return;
+        }
+        out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+        bool first = true;
+        long long dropped = 0;
+        writeThreadName(out, first, 0, "Main");
+        if (producer_.end_ns > producer_.start_ns) writeEvent(out, first, "produce", 0, producer_.start_ns, producer_.end_ns);
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+            int tid = static_cast<int>(i) + 1;
+            writeThreadName(out, first, tid, "Worker " + std::to_string(i));
+            for (const TraceEvent& e : workers_[i].events) writeEvent(out, first, e.name, tid, e.start_ns, e.end_ns);
+            dropped += workers_[i].dropped;
+        }
+        out << "\n]}\n";
+        std::cout << "Trace written to " << trace_file_;
+        if (dropped) std::cout << " (" << dropped << " spans over the per-thread limit were dropped)";
+        std::cout << std::endl;
+    }
+
+    bool enabled_ = false;
+    bool tracing_ = false;
+    std::string trace_file_;
+    std::int64_t origin_ns_ = 0;
+    std::vector<WorkerStats> workers_;
+    ProducerStats producer_;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Bounded lock-free multi-producer/multi-consumer ring buffer
+// (Dmitry Vyukov's sequence-number design). Every cell carries a sequence
+// number that tells producers and consumers whose turn it is, so push/pop
+// is a single CAS on the shared position with no mutex.
+//
+// The blocking push()/pop() wrappers spin a little, then yield, then park
+// on a condition variable. The bounded capacity gives backpressure: a
+// producer that gets ahead of the workers waits instead of growing memory.
+template <typename T>
+class MpmcRing {
+public:
+    explicit MpmcRing(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) size <<= 1; // power of two so we can mask
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    // rough number of items in the ring (exact when nobody is mid-operation)
+    std::size_t sizeApprox() const {
+        std::size_t enq = enqueue_pos_.load();
+        std::size_t deq = dequeue_pos_.load();
+        return enq > deq ? enq - deq : 0;
+    }
+
+    bool tryPush(const T& value) {
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1)) break;
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        if (consumers_parked_.load() > 0) wake(consumer_cv_);
+        return true;
+    }
+
+    bool tryPop(T& out) {
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1)) break;
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        out = cell->value;
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        if (producers_parked_.load() > 0) wake(producer_cv_);
+        return true;
+    }
+
+    // blocks (spin, then park) while the ring is full
+    void push(const T& value) {
+        for (int attempt = 0; !tryPush(value); ++attempt) {
+            if (attempt < kSpinTries) continue;
+            if (attempt < kSpinTries + kYieldTries) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(park_m_);
+            producers_parked_.fetch_add(1);
+            producer_cv_.wait(lock, [&] { return sizeApprox() < capacity(); });
+            producers_parked_.fetch_sub(1);
+            attempt = 0;
+        }
+    }
+
+    // blocks (spin, then park) while the ring is empty.
+    // returns false once close() was called and everything has been taken.
+    bool pop(T& out) {
+        for (int attempt = 0; !tryPop(out); ++attempt) {
+            if (closed_.load() && sizeApprox() == 0) return false;
+            if (attempt < kSpinTries) continue;
+            if (attempt < kSpinTries + kYieldTries) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(park_m_);
+            consumers_parked_.fetch_add(1);
+            consumer_cv_.wait(lock, [&] { return sizeApprox() > 0 || closed_.load(); });
+            consumers_parked_.fetch_sub(1);
+            attempt = 0;
+        }
+        return true;
+    }
+
+    // producer side: no more pushes are coming
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(park_m_);
+            closed_.store(true);
+        }
+        consumer_cv_.notify_all();
+    }
+
+private:
+    static constexpr int kSpinTries = 64;
+    static constexpr int kYieldTries = 16;
+
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+
+    void wake(std::condition_variable& cv) {
+        std::lock_guard<std::mutex> lock(park_m_);
+        cv.notify_one();
+    }
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_;
+
+    // producers and consumers hammer different positions, keep them on separate lines
+    alignas(64) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<std::size_t> dequeue_pos_{0};
+
+    alignas(64) std::atomic<int> producers_parked_{0};
+    std::atomic<int> consumers_parked_{0};
+    std::atomic<bool> closed_{false};
+    std::mutex park_m_;
+    std::condition_variable producer_cv_;
+    std::condition_variable consumer_cv_;
+};
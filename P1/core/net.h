@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600 // WSAPoll
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Minimal blocking TCP on top of winsock / BSD sockets, just what the cluster
+// mode (core/cluster.h) needs:
+//   Socket        - owns one socket, closes it on destruction
+//   listenTcp     - listening socket on every interface
+//   connectTcp    - connects to host:port (name or address)
+//   waitReadable  - poll() over several sockets with a timeout
+// Messages are length-prefixed frames, see sendFrame / FrameReader.
+
+#if defined(_WIN32)
+using SocketHandle = SOCKET;
+constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+#else
+using SocketHandle = int;
+constexpr SocketHandle kInvalidSocket = -1;
+#endif
+
+// WSAStartup on Windows, ignore SIGPIPE elsewhere (a dead peer shows up as a
+// failed send instead of killing the process). Call once before anything else.
+inline bool initNetworking() {
+#if defined(_WIN32)
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    signal(SIGPIPE, SIG_IGN);
+    return true;
+#endif
+}
+
+class Socket {
+public:
+    Socket() = default;
+    explicit Socket(SocketHandle handle) : handle_(handle) {}
+    Socket(Socket&& other) noexcept : handle_(std::exchange(other.handle_, kInvalidSocket)) {}
+    Socket& operator=(Socket&& other) noexcept {
+        if (this != &other) {
+            close();
+            handle_ = std::exchange(other.handle_, kInvalidSocket);
+        }
+        return *this;
+    }
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+    ~Socket() { close(); }
+
+    bool valid() const { return handle_ != kInvalidSocket; }
+    SocketHandle handle() const { return handle_; }
+
+    void close() {
+        if (!valid()) return;
+#if defined(_WIN32)
+        closesocket(handle_);
+#else
+        ::close(handle_);
+#endif
+        handle_ = kInvalidSocket;
+    }
+
+    // sends all of data, false once the peer is gone
+    bool sendAll(const void* data, std::size_t size) const {
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+            int chunk = size > (1u << 30) ? (1 << 30) : static_cast<int>(size);
+            int sent = static_cast<int>(::send(handle_, p, chunk, 0));
+            if (sent <= 0) return false;
+            p += sent;
+            size -= static_cast<std::size_t>(sent);
+        }
+        return true;
+    }
+
+    // reads whatever is available (blocks if nothing is), 0 = closed, < 0 = error
+    long receiveSome(void* data, std::size_t size) const {
+        int chunk = size > (1u << 30) ? (1 << 30) : static_cast<int>(size);
+        return static_cast<long>(::recv(handle_, static_cast<char*>(data), chunk, 0));
+    }
+
+    // reads exactly size bytes, false if the connection ends first
+    bool receiveAll(void* data, std::size_t size) const {
+        char* p = static_cast<char*>(data);
+        while (size > 0) {
+            long got = receiveSome(p, size);
+            if (got <= 0) return false;
+            p += got;
+            size -= static_cast<std::size_t>(got);
+        }
+        return true;
+    }
+
+private:
+    SocketHandle handle_ = kInvalidSocket;
+};
+
+inline Socket listenTcp(int port, std::string& error) {
+    Socket s(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    if (!s.valid()) {
+        error = "could not create a socket";
+        return Socket();
+    }
+    int yes = 1;
+    setsockopt(s.handle(), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes));
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<std::uint16_t>(port));
+    if (::bind(s.handle(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(s.handle(), 64) != 0) {
+        error = "could not listen on port " + std::to_string(port);
+        return Socket();
+    }
+    return s;
+}
+
+inline Socket acceptTcp(const Socket& listener, std::string& peer) {
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    Socket s(::accept(listener.handle(), reinterpret_cast<sockaddr*>(&addr), &len));
+    if (s.valid()) {
+        char text[INET_ADDRSTRLEN] = {};
+        inet_ntop(AF_INET, &addr.sin_addr, text, sizeof(text));
+        peer = std::string(text) + ":" + std::to_string(ntohs(addr.sin_port));
+        int yes = 1;
+        setsockopt(s.handle(), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&yes), sizeof(yes));
+    }
+    return s;
+}
+
+inline Socket connectTcp(const std::string& host, int port, std::string& error) {
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found) != 0 || !found) {
+        error = "could not resolve " + host;
+        return Socket();
+    }
+    Socket s;
+    for (addrinfo* a = found; a && !s.valid(); a = a->ai_next) {
+        Socket attempt(::socket(a->ai_family, a->ai_socktype, a->ai_protocol));
+        if (attempt.valid() && ::connect(attempt.handle(), a->ai_addr, static_cast<socklen_t>(a->ai_addrlen)) == 0) {
+            s = std::move(attempt);
+        }
+    }
+    freeaddrinfo(found);
+    if (!s.valid()) {
+        error = "could not connect to " + host + ":" + std::to_string(port);
+        return Socket();
+    }
+    int yes = 1;
+    setsockopt(s.handle(), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&yes), sizeof(yes));
+    return s;
+}
+
+// waits up to timeout_ms for any of the sockets to become readable (or
+// closed); ready[i] says which. Returns false on a poll error.
+inline bool waitReadable(const std::vector<SocketHandle>& sockets, int timeout_ms, std::vector<bool>& ready) {
+#if defined(_WIN32)
+    std::vector<WSAPOLLFD> fds(sockets.size());
+#else
+    std::vector<pollfd> fds(sockets.size());
+#endif
+    for (std::size_t i = 0; i < sockets.size(); ++i) {
+        fds[i].fd = sockets[i];
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+#if defined(_WIN32)
+    int result = WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), timeout_ms);
+#else
+    int result = ::poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout_ms);
+#endif
+    ready.assign(sockets.size(), false);
+    if (result < 0) return false;
+    for (std::size_t i = 0; i < sockets.size(); ++i) {
+        ready[i] = (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+    }
+    return true;
+}
+
+// --- Framing ---
+// every message is [uint32 type][uint32 payload bytes][payload], in host
+// byte order (both ends are expected to be little-endian x86/ARM)
+
+constexpr std::uint32_t kMaxFramePayload = 1u << 30;
+
+inline bool sendFrame(const Socket& s, std::uint32_t type, const void* payload, std::uint32_t size) {
+    std::uint32_t header[2] = {type, size};
+    return s.sendAll(header, sizeof(header)) && (size == 0 || s.sendAll(payload, size));
+}
+
+struct Frame {
+    std::uint32_t type = 0;
+    std::vector<std::uint8_t> payload;
+};
+
+// blocking receive of one whole frame
+inline bool receiveFrame(const Socket& s, Frame& frame) {
+    std::uint32_t header[2];
+    if (!s.receiveAll(header, sizeof(header)) || header[1] > kMaxFramePayload) return false;
+    frame.type = header[0];
+    frame.payload.resize(header[1]);
+    return header[1] == 0 || s.receiveAll(frame.payload.data(), header[1]);
+}
+
+// collects bytes from a socket that poll() said was readable and hands out
+// the frames once they are complete (for a loop that serves many sockets)
+class FrameReader {
+public:
+    // reads what is there; false once the connection is closed or broken
+    bool readAvailable(const Socket& s) {
+        std::uint8_t chunk[64 * 1024];
+        long got = s.receiveSome(chunk, sizeof(chunk));
+        if (got <= 0) return false;
+        buffer_.insert(buffer_.end(), chunk, chunk + got);
+        return true;
+    }
+
+    // takes the next complete frame out of the buffer; false if there is none
+    // yet, or if the peer sent a bad length (bad is then set)
+    bool next(Frame& frame, bool& bad) {
+        bad = false;
+        std::size_t available = buffer_.size() - start_;
+        if (available < 8) return false;
+        std::uint32_t header[2];
+        std::memcpy(header, buffer_.data() + start_, sizeof(header));
+        if (header[1] > kMaxFramePayload) {
+            bad = true;
+            return false;
+        }
+        if (available < 8 + static_cast<std::size_t>(header[1])) return false;
+        frame.type = header[0];
+        const std::uint8_t* payload = buffer_.data() + start_ + 8;
+        frame.payload.assign(payload, payload + header[1]);
+        start_ += 8 + static_cast<std::size_t>(header[1]);
+        if (start_ == buffer_.size()) {
+            buffer_.clear();
+            start_ = 0;
+        } else if (start_ > (1u << 20)) {
+            buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(start_));
+            start_ = 0;
+        }
+        return true;
+    }
+
+private:
+    std::vector<std::uint8_t> buffer_;
+    std::size_t start_ = 0; // bytes of buffer_ already handed out
+};
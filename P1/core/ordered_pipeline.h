@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Ordered, bounded hand-off from many workers to one writer.
+// Work items are numbered 0..total-1. Workers claim the next number,
+// produce its value in any order, and complete it; the writer takes the
+// values back out strictly in number order. At most `window` items can be
+// claimed but not yet written, so memory stays bounded no matter how far
+// the fastest worker gets ahead.
+template <typename T>
+class OrderedPipeline {
+public:
+    OrderedPipeline(std::size_t window, std::size_t total)
+        : window_(window < 1 ? 1 : window), total_(total), slots_(window_), ready_(window_, false) {}
+
+    std::size_t total() const { return total_; }
+
+    // worker side: claims the next item, waiting while the window is full.
+    // returns false once every item has been claimed.
+    bool claim(std::size_t& index) {
+        std::unique_lock<std::mutex> lock(m_);
+        if (next_claim_ >= total_) return false;
+        index = next_claim_++;
+        space_cv_.wait(lock, [&] { return index < next_write_ + window_; });
+        std::size_t in_flight = index - next_write_ + 1;
+        if (in_flight > peak_in_flight_) peak_in_flight_ = in_flight;
+        return true;
+    }
+
+    // worker side: hands over the value for a claimed item
+    void complete(std::size_t index, T&& value) {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            slots_[index % window_] = std::move(value);
+            ready_[index % window_] = true;
+        }
+        ready_cv_.notify_all();
+    }
+
+    // writer side: waits for the next item in order. returns false when all were written.
+    bool next(T& out) {
+        std::unique_lock<std::mutex> lock(m_);
+        if (next_write_ >= total_) return false;
+        std::size_t slot = next_write_ % window_;
+        ready_cv_.wait(lock, [&] { return ready_[slot]; });
+        out = std::move(slots_[slot]);
+        slots_[slot] = T();
+        ready_[slot] = false;
+        ++next_write_;
+        lock.unlock();
+        space_cv_.notify_all(); // a worker may now claim past the old window
+        return true;
+    }
+
+    // most items that were claimed but not written at the same time
+    std::size_t peakInFlight() const {
+        std::lock_guard<std::mutex> lock(m_);
+        return peak_in_flight_;
+    }
+
+private:
+    const std::size_t window_;
+    const std::size_t total_;
+    std::vector<T> slots_;
+    std::vector<bool> ready_;
+    std::size_t next_claim_ = 0;
+    std::size_t next_write_ = 0;
+    std::size_t peak_in_flight_ = 0;
+    mutable std::mutex m_;
+    std::condition_variable space_cv_;
+    std::condition_variable ready_cv_;
+};
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "async_logger.h"
+#include "config.h"
+#include "instrumentation.h"
+#include "ordered_pipeline.h"
+#include "prime_file.h"
+#include "result_buffer.h"
+#include "sieve_cache.h"
+#include "timestamp.h"
+
+// Output policies: what a worker does with each prime it finds.
+// Used as a template parameter of runPrimeSearch, so onPrime() is resolved
+// at compile time and inlined into the worker loops.
+//
+// Every policy has:
+//   kName                     - shown in the run header
+//   kStreaming                - false: workers call onPrime() for each prime
+//                               true: workers hand in whole ordered segments (StreamingPrint)
+//   Policy(settings)          - set up before the worker threads start
+//   expectNumbers(worker, lo, hi, sharers)
+//                             - before the workers start: worker will see about
+//                               1/sharers of the numbers in [lo, hi]
+//   workerStarted(worker)     - first call from worker thread `worker` (after it is pinned),
+//                               per-worker buffers get allocated here so they land on its NUMA node
+//   onPrime(worker, prime)    - called from worker thread `worker`
+//   workersDone()             - after every worker has been joined (still timed)
+//   printResults()            - after the timer stops
+
+// summary line for RESULT_FILE
+inline void printResultFile(const std::string& path, const PrimeFileWriter& writer, bool ok) {
+    if (!ok) {
+        std::cerr << "Error: Could not write result file " << path << std::endl;
+        return;
+    }
+    std::cout << "Result file: " << path << " (" << writer.segmentCount() << " segments, "
+              << writer.fileBytes() << " bytes)" << std::endl;
+}
+
+// Immediate Print: the thread that finds a prime prints it right away
+class ImmediatePrint {
+public:
+    static constexpr const char* kName = "Immediate Print";
+    static constexpr bool kStreaming = false;
+
+    explicit ImmediatePrint(const SearchSettings& settings) {
+        // pick how primes get printed (direct to cout unless LOGGER=async)
+        if (settings.logger == "async") {
+            logger_ = std::make_unique<AsyncLogger>();
+            std::cout << "Logger: async (batched background writer)" << std::endl;
+            logger_->start();
+        } else if (settings.logger != "direct") {
+            std::cerr << "Unknown LOGGER '" << settings.logger << "', printing directly." << std::endl;
+        }
+    }
+
+    void expectNumbers(int, long long, long long, long long) {}
+    void workerStarted(int) {}
+
+    // prints one prime with its timestamp and thread id
+    // (formats into stack buffers, so there are no heap allocations per line)
+    void onPrime(int worker, long long num) {
+        if (logger_) {
+            stats_.addPrimes(worker, 1);
+            // timestamp is taken now, the writer thread only does the actual output
+            char line[160];
+            std::size_t len = formatLogPrefix(line);
+            len += std::snprintf(line + len, sizeof(line) - len, "Found prime: %lld\n", num);
+            logger_->append(line, len);
+            return;
+        }
+        stats_.addPrimes(worker, 1);
+        char stamp[kTimestampBufferSize];
+        formatTimestamp(stamp);
+        // lock so threads don't print at the same time
+        // (try first, so only a lock that actually blocks gets timed)
+        std::unique_lock<std::mutex> lock(cout_mutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            std::int64_t wait_start = stats_.enabled() ? Instrumentation::nowNs() : 0;
+            lock.lock();
+            if (stats_.enabled()) stats_.addCoutWait(worker, wait_start, Instrumentation::nowNs());
+        }
+        std::cout << "[Time: " << stamp
+                  << "] [Thread: " << getThreadId()
+                  << "] Found prime: " << num << std::endl;
+    }
+
+    void workersDone() {
+        // make sure every queued line is written before the summary
+        if (logger_) logger_->stop();
+    }
+
+    void printResults() {
+        std::cout << "All threads finished." << std::endl;
+    }
+
+private:
+    std::mutex cout_mutex_; // mutex to make sure threads don't mess up the output
+    std::unique_ptr<AsyncLogger> logger_;
+    Instrumentation& stats_ = Instrumentation::get();
+};
+
+// Batched Print: threads only collect primes, main prints them all at the end
+class BatchedPrint {
+public:
+    static constexpr const char* kName = "Batched Print";
+    static constexpr bool kStreaming = false;
+
+    explicit BatchedPrint(const SearchSettings& settings)
+        : result_file_(settings.result_file),
+          file_segment_size_(settings.stream_segment_size < 1 ? 1 : settings.stream_segment_size),
+          all_results_(static_cast<std::size_t>(settings.thread_count)),
+          pending_(static_cast<std::size_t>(settings.thread_count)) {
+        // pick how the primes are stored until the end (RESULT_STORAGE, raw by default)
+        if (!parseResultEncoding(settings.result_storage, encoding_)) {
+            std::cerr << "Unknown RESULT_STORAGE '" << settings.result_storage << "', using raw." << std::endl;
+        }
+    }
+
+    // pre-sizes this worker's buffer from a prime-counting estimate
+    void expectNumbers(int worker, long long lo, long long hi, long long sharers) {
+        ResultEncoding encoding = encoding_;
+        // a bitmap needs to own its whole range, shared ranges keep 32-bit gaps instead
+        if (encoding == ResultEncoding::Bitset && sharers > 1) {
+            encoding = ResultEncoding::Delta32;
+            bitset_fallback_ = true;
+        }
+        if (lo < range_lo_) range_lo_ = lo;
+        if (hi > range_hi_) range_hi_ = hi;
+        std::size_t expected = primesInRangeEstimate(lo, hi) / static_cast<std::size_t>(sharers < 1 ? 1 : sharers);
+        pending_[worker] = {encoding, lo, hi, expected};
+    }
+
+    // the worker allocates its own buffer, so the memory is local to wherever it runs
+    void workerStarted(int worker) {
+        const PendingBuffer& p = pending_[worker];
+        all_results_[worker].init(p.encoding, p.lo, p.hi, p.expected);
+    }
+
+    void onPrime(int worker, long long num) {
+        // no mutex needed - each thread has its own (cache-line aligned) buffer
+        all_results_[worker].push(num);
+    }
+
+    void workersDone() {
+        for (std::size_t i = 0; i < all_results_.size(); ++i) {
+            Instrumentation::get().addPrimes(static_cast<int>(i), static_cast<long long>(all_results_[i].size()));
+        }
+    }
+
+    void printResults() {
+        std::cout << "All threads finished. Consolidating and printing results..." << std::endl;
+
+        // Now, print all the results from the main thread
+        long long total_primes = 0;
+        std::size_t total_bytes = 0;
+        for (std::size_t i = 0; i < all_results_.size(); ++i) {
+            std::cout << "--- Results from Thread " << i << " (" << all_results_[i].size() << " primes) ---" << std::endl;
+            all_results_[i].forEach([&](long long prime) {
+                std::cout << prime << " ";
+                total_primes++;
+            });
+            std::cout << std::endl;
+            total_bytes += all_results_[i].memoryBytes();
+        }
+
+        std::cout << "------------------------------------------" << std::endl;
+        std::cout << "Total primes found: " << total_primes << std::endl;
+        std::cout << "Result storage: " << (bitset_fallback_ ? "delta32 (bitset needs range division)" : resultEncodingName(encoding_))
+                  << ", " << total_bytes << " bytes" << std::endl;
+        if (!result_file_.empty()) writeResultFile();
+    }
+
+private:
+    // RESULT_FILE: all primes, ascending, cut into STREAM_SEGMENT_SIZE segments
+    void writeResultFile() {
+        if (range_hi_ < range_lo_) return; // no worker had any numbers
+        std::vector<long long> primes;
+        for (const PrimeResultBuffer& buffer : all_results_) {
+            buffer.forEach([&](long long prime) { primes.push_back(prime); });
+        }
+        std::sort(primes.begin(), primes.end()); // number division finds them out of order
+
+        PrimeFileWriter writer;
+        bool ok = writer.open(result_file_, range_lo_);
+        std::size_t next = 0;
+        for (long long lo = range_lo_; ok && lo <= range_hi_; ) {
+            long long hi = (range_hi_ - lo >= file_segment_size_) ? lo + file_segment_size_ - 1 : range_hi_;
+            std::size_t end = next;
+            while (end < primes.size() && primes[end] <= hi) ++end;
+            ok = writer.addSegment(lo, hi, primes.data() + next, end - next);
+            next = end;
+            if (hi == range_hi_) break;
+            lo = hi + 1;
+        }
+        ok = writer.finish() && ok;
+        printResultFile(result_file_, writer, ok);
+    }
+
+    std::string result_file_;
+    long long file_segment_size_;
+    long long range_lo_ = LLONG_MAX; // numbers the workers were told about
+    long long range_hi_ = LLONG_MIN;
+    ResultEncoding encoding_ = ResultEncoding::Raw;
+    bool bitset_fallback_ = false;
+    // one buffer for each thread to store its results
+    std::vector<PrimeResultBuffer> all_results_;
+    // what expectNumbers asked for, set up by workerStarted
+    struct PendingBuffer {
+        ResultEncoding encoding = ResultEncoding::Raw;
+        long long lo = 0;
+        long long hi = -1;
+        std::size_t expected = 0;
+    };
+    std::vector<PendingBuffer> pending_;
+};
+
+// Streaming Print (BATCH_OUTPUT=stream): the batched variants' bounded-memory mode.
+// The search range is cut into segments that range workers claim in ascending
+// order. Finished segments go through an ordered pipeline to a writer thread,
+// which prints them in ascending order as soon as the next one is ready.
+// At most STREAM_IN_FLIGHT segments are held in memory at once.
+class StreamingPrint {
+public:
+    static constexpr const char* kName = "Batched Print";
+    static constexpr bool kStreaming = true;
+
+    explicit StreamingPrint(const SearchSettings& settings)
+        : segment_size_(settings.stream_segment_size < 1 ? 1 : settings.stream_segment_size),
+          in_flight_(settings.stream_in_flight > 0 ? settings.stream_in_flight : 2 * settings.thread_count),
+          result_file_(settings.result_file) {
+        std::cout << "Output: streaming (segments of " << segment_size_ << " numbers, at most "
+                  << in_flight_ << " in flight)" << std::endl;
+        if (!settings.cache_file.empty()) {
+            cache_ = std::make_unique<SieveCache>();
+            std::string error;
+            if (cache_->open(settings.cache_file, error)) {
+                std::cout << "Cache: " << settings.cache_file << " has 2-" << cache_->last()
+                          << " (" << cache_->mappedSegments() << " segments)" << std::endl;
+            } else {
+                std::cerr << "Error: " << error << ", running without the cache." << std::endl;
+                cache_.reset();
+            }
+        }
+    }
+
+    // called once before the workers start: sets up the segments of [first, last] and starts the writer
+    void startStream(long long first, long long last) {
+        first_ = first;
+        last_ = last;
+        std::size_t total = (last >= first) ? static_cast<std::size_t>((last - first) / segment_size_ + 1) : 0;
+        pipeline_ = std::make_unique<OrderedPipeline<std::vector<long long>>>(static_cast<std::size_t>(in_flight_), total);
+        // segments are written to RESULT_FILE straight from the writer thread
+        file_ok_ = result_file_.empty() || file_.open(result_file_, first);
+        writer_ = std::thread(&StreamingPrint::writerLoop, this);
+    }
+
+    void workerStarted(int) {}
+
+    // worker side: claims the next segment [lo, hi], waiting while too many are in flight
+    bool claimSegment(std::size_t& index, long long& lo, long long& hi) {
+        if (!pipeline_->claim(index)) return false;
+        lo = first_ + static_cast<long long>(index) * segment_size_;
+        hi = (last_ - lo >= segment_size_) ? lo + segment_size_ - 1 : last_;
+        return true;
+    }
+
+    // worker side: puts the cached primes of [lo, hi] into primes and returns
+    // the first number that still has to be searched (hi + 1 if all were cached)
+    long long takeCached(long long lo, long long hi, std::vector<long long>& primes) const {
+        if (!cache_ || lo > cache_->mappedLast()) return lo;
+        long long cached_hi = (hi < cache_->mappedLast()) ? hi : cache_->mappedLast();
+        cache_->forEachCached(lo, cached_hi, [&](long long prime) { primes.push_back(prime); });
+        return cached_hi + 1;
+    }
+
+    // worker side: hands in the primes of a claimed segment (ascending)
+    void completeSegment(std::size_t index, std::vector<long long>&& primes) {
+        pipeline_->complete(index, std::move(primes));
+    }
+
+    void workersDone() {
+        if (writer_.joinable()) writer_.join();
+        if (!result_file_.empty()) file_ok_ = file_.finish() && file_ok_;
+    }
+
+    void printResults() {
+        std::cout << "All threads finished. Results were streamed in ascending order." << std::endl;
+        std::cout << "------------------------------------------" << std::endl;
+        std::cout << "Total primes found: " << total_primes_ << std::endl;
+        if (pipeline_) std::cout << "Peak segments in flight: " << pipeline_->peakInFlight() << std::endl;
+        if (!result_file_.empty()) printResultFile(result_file_, file_, file_ok_);
+        if (cache_) {
+            std::cout << "Cache: reused up to " << cache_->mappedLast() << ", appended "
+                      << cache_->appendedSegments() << " segments, now has 2-" << cache_->last() << std::endl;
+        }
+    }
+
+private:
+    void writerLoop() {
+        std::vector<long long> primes;
+        std::size_t index = 0;
+        while (pipeline_->next(primes)) {
+            long long lo = first_ + static_cast<long long>(index) * segment_size_;
+            long long hi = (last_ - lo >= segment_size_) ? lo + segment_size_ - 1 : last_;
+            std::cout << "--- Results from Segment " << index << " [" << lo << ", " << hi << "] ("
+                      << primes.size() << " primes) ---" << std::endl;
+            for (long long prime : primes) {
+                std::cout << prime << " ";
+            }
+            std::cout << std::endl;
+            if (!result_file_.empty() && file_ok_) file_ok_ = file_.addSegment(lo, hi, primes);
+            if (cache_ && !cache_write_failed_) extendCache(lo, hi, primes);
+            total_primes_ += static_cast<long long>(primes.size());
+            ++index;
+        }
+    }
+
+    // appends the part of a segment past the cached end (if it joins up with it)
+    void extendCache(long long lo, long long hi, const std::vector<long long>& primes) {
+        long long from = cache_->last() + 1;
+        if (lo > from || hi < from) return;
+        std::size_t skip = 0;
+        while (skip < primes.size() && primes[skip] < from) ++skip;
+        if (!cache_->append(from, hi, primes.data() + skip, primes.size() - skip)) {
+            std::cerr << "Error: Could not extend the cache, it stays at 2-" << cache_->last() << std::endl;
+            cache_write_failed_ = true;
+        }
+    }
+
+    long long segment_size_;
+    long long in_flight_;
+    long long first_ = 0;
+    long long last_ = 0;
+    std::string result_file_;
+    PrimeFileWriter file_;
+    bool file_ok_ = true;
+    std::unique_ptr<SieveCache> cache_;     // CACHE_FILE, appended to by the writer thread only
+    bool cache_write_failed_ = false;
+    long long total_primes_ = 0; // only touched by the writer until it is joined
+    std::unique_ptr<OrderedPipeline<std::vector<long long>>> pipeline_;
+    std::thread writer_;
+};
@@ -0,0 +1,526 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "affinity.h"
+#include "config.h"
+#include "instrumentation.h"
+#include "mpmc_ring.h"
+#include "primality.h"
+#include "range_split.h"
+#include "result_buffer.h"
+#include "segmented_sieve.h"
+#include "simd_trial.h"
+#include "thread_pool.h"
+#include "wheel.h"
+#include "work_stealing.h"
+
+// Partitioning policies: how the numbers 2..MAX_NUMBER are split between
+// the worker threads. Used as a template parameter of runPrimeSearch,
+// together with an output policy (see output_policy.h).
+//
+// Every policy has:
+//   kName                - shown in the run header
+//   kSupportsStreaming   - whether it can feed a streaming output policy
+//   Policy(settings)     - picks/sets up its algorithm before the timer-sensitive part
+//   run(output)          - starts the workers, feeds them, joins them
+//
+// Both are templates over the fixed-build THREAD_COUNT / ALGORITHM (0 and
+// Runtime unless config.h's P1_FIXED_* macros are set); RangeDivision and
+// NumberDivision are the instantiations the build uses.
+
+// The worker threads of one run: fresh std::threads, or jobs on the shared
+// thread pool when THREAD_POOL=on (no thread creation cost per run)
+class WorkerGroup {
+public:
+    explicit WorkerGroup(const SearchSettings& settings) : use_pool_(settings.thread_pool == "on") {
+        // every worker needs its own pool thread, they wait on each other
+        if (use_pool_) ThreadPool::shared().reserve(static_cast<std::size_t>(settings.thread_count));
+        else if (settings.thread_pool != "off") {
+            std::cerr << "Unknown THREAD_POOL '" << settings.thread_pool << "', starting new threads." << std::endl;
+        }
+    }
+
+    template <typename Fn>
+    void start(Fn&& fn) {
+        if (use_pool_) jobs_.push_back(ThreadPool::shared().submit(std::forward<Fn>(fn)));
+        else threads_.emplace_back(std::forward<Fn>(fn));
+    }
+
+    void join() {
+        for (std::thread& t : threads_) t.join();
+        for (std::future<void>& job : jobs_) job.get();
+        threads_.clear();
+        jobs_.clear();
+    }
+
+private:
+    bool use_pool_;
+    std::vector<std::thread> threads_;
+    std::vector<std::future<void>> jobs_;
+};
+
+// first steps of every worker thread: pin it (AFFINITY), let the output policy
+// set up the worker's buffers from the pinned thread, start its counters
+template <typename Output>
+void beginWorker(const ThreadPlacement& placement, Output& output, int worker) {
+    placement.pin(worker);
+    output.workerStarted(worker);
+    Instrumentation::get().workerStart(worker);
+}
+
+// Range Division: every thread gets one contiguous range up front
+template <long long kThreads, FixedAlgorithm kAlgorithm>
+class BasicRangeDivision {
+public:
+    static constexpr const char* kName = "Range Division";
+    static constexpr bool kSupportsStreaming = true;
+
+    explicit BasicRangeDivision(const SearchSettings& settings)
+        : settings_(settings), placement_(settings.affinity, settings.thread_count) {
+        // pick the algorithm (trial division unless ALGORITHM=sieve)
+        std::string algorithm = settings.algorithm;
+        if (algorithm == "sieve") {
+            sieve_ = std::make_unique<SegmentedSieve>(settings.max_number, settings.sieve_segment_size);
+        } else if (algorithm != "trial") {
+            std::cerr << "Unknown ALGORITHM '" << algorithm << "', using trial division." << std::endl;
+            algorithm = "trial";
+        }
+        std::cout << "Algorithm: " << algorithm << std::endl;
+        if (!sieve_) {
+            is_prime_ = makePrimalityTest(settings.primality, settings.miller_rabin_threshold, std::cout);
+            wheel_.configure(settings.wheel, std::cout); // the sieve already skips composites by itself
+            // batch the trial divisions of each range through a SIMD kernel (unless SIMD=off)
+            SimdLevel level;
+            if (pickSimdLevel(settings.simd, level)) {
+                trial_batch_ = trialBatchKernel(level);
+                std::cout << "SIMD trial kernel: " << simdLevelName(level) << std::endl;
+            }
+        }
+
+        // pick how the range is cut up (RANGE_SPLIT, equal by default)
+        if (settings.range_split == "cost") {
+            split_ = Split::Cost;
+            std::cout << "Range split: cost (about the same estimated work per thread)" << std::endl;
+        } else if (settings.range_split == "dynamic") {
+            split_ = Split::Dynamic;
+            std::cout << "Range split: dynamic (threads claim " << rangeChunk() << " numbers at a time)" << std::endl;
+        } else {
+            if (settings.range_split != "equal") {
+                std::cerr << "Unknown RANGE_SPLIT '" << settings.range_split << "', using equal ranges." << std::endl;
+            }
+            std::cout << "Range split: equal" << std::endl;
+        }
+    }
+
+    template <typename Output>
+    void run(Output& output) {
+        if constexpr (Output::kStreaming) {
+            runStreaming(output); // claims segments in order already, RANGE_SPLIT doesn't apply
+        } else {
+            if (split_ == Split::Dynamic) runDynamic(output);
+            else runRanges(output);
+        }
+    }
+
+private:
+    enum class Split { Equal, Cost, Dynamic };
+
+    long long rangeChunk() const { return settings_.range_chunk < 1 ? 1 : settings_.range_chunk; }
+    long long threadCount() const { return kThreads > 0 ? kThreads : settings_.thread_count; }
+
+    // thread count + 1 bounds, thread i gets [bounds[i] + 1, bounds[i + 1]]
+    // (ends rather than starts, so nothing is computed past last)
+    std::vector<long long> rangeBounds(long long first, long long last, int thread_count) const {
+        if (split_ == Split::Cost && !sieve_) {
+            // trial division gets slower as n grows, Miller-Rabin barely does
+            return costBalancedBounds(first, last, thread_count, [this](double n) {
+                return is_prime_.usesTrialDivision(static_cast<long long>(n)) ? trialDivisionCost(n) : millerRabinCost(n);
+            });
+        }
+        // equal ranges (a sieve costs about the same everywhere, so it splits these too)
+        std::vector<long long> bounds(static_cast<std::size_t>(thread_count) + 1);
+        long long range_size = (last - first + 1) / thread_count;
+        for (int i = 0; i < thread_count; ++i) bounds[i] = first - 1 + i * range_size;
+        // last thread gets any leftover numbers
+        bounds[thread_count] = last;
+        return bounds;
+    }
+
+    // one contiguous range per thread
+    template <typename Output>
+    void runRanges(Output& output) {
+        long long thread_count = threadCount();
+        long long max_number = settings_.max_number;
+
+        // the split starts at 1 (or MIN_NUMBER), 1 itself gets skipped below
+        long long first = (settings_.min_number > 2) ? settings_.min_number : 1;
+
+        // create threads and divide the work
+        WorkerGroup workers(settings_);
+        std::vector<long long> bounds = rangeBounds(first, max_number, static_cast<int>(thread_count));
+
+        for (int i = 0; i < thread_count; ++i) {
+            // skip if we don't have enough numbers
+            if (bounds[i] >= max_number) break;
+
+            long long start = bounds[i] + 1;
+            long long end = bounds[i + 1];
+            if (i == 0 && start == 1) start = 2; // 1 isn't prime, so skip it
+            if (start > end) continue;
+
+            output.expectNumbers(i, start, end, 1);
+
+            workers.start([this, &output, i, start, end] {
+                beginWorker(placement_, output, i);
+                searchBlock(output, i, start, end);
+                stats_.workerEnd(i);
+            });
+        }
+
+        // wait for all threads to finish
+        workers.join();
+    }
+
+    // Claims the next [lo, hi] (up to chunk numbers) of [first, last]; false once
+    // all are handed out. A CAS on the count handed out rather than a fetch_add
+    // on the next number, so the cursor never runs past last (or LLONG_MAX).
+    static bool claimChunk(std::atomic<unsigned long long>& cursor, long long first, long long last, long long chunk,
+                           long long& lo, long long& hi) {
+        const unsigned long long span = static_cast<unsigned long long>(last - first) + 1;
+        unsigned long long done = cursor.load(std::memory_order_relaxed);
+        unsigned long long take;
+        do {
+            if (done >= span) return false;
+            take = std::min(static_cast<unsigned long long>(chunk), span - done);
+        } while (!cursor.compare_exchange_weak(done, done + take, std::memory_order_relaxed));
+        lo = first + static_cast<long long>(done);
+        hi = lo + static_cast<long long>(take - 1);
+        return true;
+    }
+
+    // RANGE_SPLIT=dynamic: threads keep claiming the next chunk from a shared cursor,
+    // so a thread that got cheap numbers just takes more of them
+    template <typename Output>
+    void runDynamic(Output& output) {
+        long long first = (settings_.min_number > 2) ? settings_.min_number : 2;
+        long long last = settings_.max_number;
+        long long chunk = rangeChunk();
+        alignas(64) std::atomic<unsigned long long> cursor{0}; // numbers handed out so far
+
+        WorkerGroup workers(settings_);
+        for (int i = 0; i < threadCount(); ++i) {
+            // every thread can end up with numbers from anywhere in the range
+            output.expectNumbers(i, first, last, threadCount());
+            workers.start([this, &output, &cursor, i, first, last, chunk] {
+                beginWorker(placement_, output, i);
+                long long lo, hi;
+                while (claimChunk(cursor, first, last, chunk, lo, hi)) searchBlock(output, i, lo, hi);
+                stats_.workerEnd(i);
+            });
+        }
+
+        // wait for all threads to finish
+        workers.join();
+    }
+
+    // collects one segment's primes for a streaming output policy
+    struct SegmentCollector {
+        std::vector<long long>& primes;
+        void onPrime(int, long long prime) { primes.push_back(prime); }
+    };
+
+    // streaming mode: threads keep claiming the next segment instead of owning one big range
+    template <typename Output>
+    void runStreaming(Output& output) {
+        long long first = (settings_.min_number > 2) ? settings_.min_number : 2;
+        output.startStream(first, settings_.max_number);
+
+        WorkerGroup workers(settings_);
+        for (int i = 0; i < threadCount(); ++i) {
+            workers.start([this, &output, i] {
+                beginWorker(placement_, output, i);
+                std::size_t index;
+                long long lo, hi;
+                while (true) {
+                    // claiming blocks while STREAM_IN_FLIGHT segments are waiting to be printed
+                    std::int64_t wait_start = stats_.enabled() ? Instrumentation::nowNs() : 0;
+                    bool claimed = output.claimSegment(index, lo, hi);
+                    if (stats_.enabled()) stats_.addWait(i, wait_start, Instrumentation::nowNs());
+                    if (!claimed) break;
+
+                    std::vector<long long> primes;
+                    primes.reserve(primesInRangeEstimate(lo, hi));
+                    // anything CACHE_FILE already has is read back instead of searched again
+                    long long from = output.takeCached(lo, hi, primes);
+                    SegmentCollector collector{primes};
+                    if (from <= hi) searchBlock(collector, i, from, hi);
+                    stats_.addPrimes(i, static_cast<long long>(primes.size()));
+                    output.completeSegment(index, std::move(primes));
+                }
+                stats_.workerEnd(i);
+            });
+        }
+
+        // wait for all threads to finish
+        workers.join();
+    }
+
+    // findPrimes_Range with the instrumentation counters around it
+    template <typename Output>
+    void searchBlock(Output& output, int worker, long long start, long long end) {
+        std::int64_t work_start = stats_.enabled() ? Instrumentation::nowNs() : 0;
+        findPrimes_Range(output, worker, start, end);
+        if (stats_.enabled()) {
+            stats_.addCandidates(worker, sieve_ ? end - start + 1 : wheel_.countCandidates(start, end));
+            stats_.addWork(worker, work_start, Instrumentation::nowNs());
+        }
+    }
+
+    // this runs in each thread - finds primes in its range and hands them to the output policy
+    template <typename Output>
+    void findPrimes_Range(Output& output, int worker, long long start, long long end) {
+        // a fixed-ALGORITHM build only compiles its own path
+        if constexpr (kAlgorithm != FixedAlgorithm::Trial) {
+            if (kAlgorithm == FixedAlgorithm::Sieve || sieve_) {
+                sieve_->forEachPrime(start, end, [&](long long prime) { output.onPrime(worker, prime); });
+                return;
+            }
+        }
+        if constexpr (kAlgorithm != FixedAlgorithm::Sieve) {
+            if (trial_batch_) {
+                findPrimes_Range_Simd(output, worker, start, end);
+                return;
+            }
+            wheel_.forEachCandidate(start, end, [&](long long num) {
+                if (is_prime_(num)) {
+                    output.onPrime(worker, num);
+                }
+            });
+        }
+    }
+
+    // same as above, but trial division candidates are collected into batches for the SIMD kernel.
+    // numbers the primality test sends to Miller-Rabin are still checked one at a time.
+    template <typename Output>
+    void findPrimes_Range_Simd(Output& output, int worker, long long start, long long end) {
+        long long batch[kTrialBatchSize];
+        bool batch_prime[kTrialBatchSize];
+        int count = 0;
+
+        // test the collected candidates and report the primes (in order)
+        auto flush = [&] {
+            if (count == 0) return;
+            trial_batch_(batch, count, batch_prime);
+            for (int k = 0; k < count; ++k) {
+                if (batch_prime[k]) output.onPrime(worker, batch[k]);
+            }
+            count = 0;
+        };
+
+        wheel_.forEachCandidate(start, end, [&](long long num) {
+            if (num < 5 || num >= kSimdTrialLimit || !is_prime_.usesTrialDivision(num)) {
+                flush();
+                if (is_prime_(num)) output.onPrime(worker, num);
+                return;
+            }
+            if (num % 2 == 0 || num % 3 == 0) return; // only left when WHEEL is off or 2
+            batch[count++] = num;
+            if (count == kTrialBatchSize) flush();
+        });
+        flush();
+    }
+
+    const SearchSettings& settings_;
+    ThreadPlacement placement_;
+    Split split_ = Split::Equal;
+    std::unique_ptr<SegmentedSieve> sieve_; // null for per-number testing
+    PrimalityTest is_prime_;
+    TrialBatchKernel trial_batch_ = nullptr; // null for the one-number-at-a-time loop
+    Wheel wheel_;                            // WHEEL, only visits numbers that could be prime
+    Instrumentation& stats_ = Instrumentation::get();
+};
+
+// Number Division: main thread produces numbers, worker threads consume them
+// (ALGORITHM doesn't apply, every number goes through the primality test)
+template <long long kThreads>
+class BasicNumberDivision {
+public:
+    static constexpr const char* kName = "Number Division";
+    static constexpr bool kSupportsStreaming = false;
+
+    explicit BasicNumberDivision(const SearchSettings& settings)
+        : settings_(settings), placement_(settings.affinity, settings.thread_count) {
+        // pick how numbers are handed out (queue, stealing or ring; queue by default)
+        if (settings.scheduler == "stealing") {
+            scheduler_ = std::make_unique<WorkStealingScheduler>(static_cast<int>(threadCount()));
+            std::cout << "Scheduler: work stealing (chunks of " << settings.chunk_size << " numbers)" << std::endl;
+        } else if (settings.scheduler == "ring") {
+            ring_ = std::make_unique<MpmcRing<long long>>(static_cast<std::size_t>(settings.queue_capacity));
+            std::cout << "Scheduler: lock-free ring (capacity " << ring_->capacity() << ")" << std::endl;
+        } else {
+            if (settings.scheduler != "queue") {
+                std::cerr << "Unknown SCHEDULER '" << settings.scheduler << "', using the shared queue." << std::endl;
+            }
+            std::cout << "Scheduler: shared queue" << std::endl;
+        }
+        is_prime_ = makePrimalityTest(settings.primality, settings.miller_rabin_threshold, std::cout);
+        wheel_.configure(settings.wheel, std::cout);
+    }
+
+    template <typename Output>
+    void run(Output& output) {
+        long long max_number = settings_.max_number;
+        long long first = (settings_.min_number > 2) ? settings_.min_number : 2;
+
+        // create worker threads
+        WorkerGroup workers(settings_);
+        for (int i = 0; i < threadCount(); ++i) {
+            output.expectNumbers(i, first, max_number, threadCount());
+            workers.start([this, &output, i] {
+                beginWorker(placement_, output, i);
+                findPrimes_Number(output, i);
+                stats_.workerEnd(i);
+            });
+        }
+
+        // main thread puts numbers in the queue
+        std::cout << "Main thread starting to produce tasks..." << std::endl;
+        std::int64_t produce_start = stats_.enabled() ? Instrumentation::nowNs() : 0;
+        long long candidates = wheel_.countCandidates(first, max_number);
+        if (!scheduler_) stats_.addProducerItems(candidates);
+        if (scheduler_) {
+            // deal out contiguous chunks, then tell threads we're done
+            stats_.addProducerItems(scheduler_->pushRange(first, max_number, settings_.chunk_size));
+            scheduler_->finish();
+            std::cout << "Main thread finished producing tasks." << std::endl;
+        } else if (ring_) {
+            // push blocks while the ring is full, so memory stays at QUEUE_CAPACITY entries
+            wheel_.forEachCandidate(first, max_number, [this](long long num) { ring_->push(num); });
+            ring_->close();
+            std::cout << "Main thread finished producing tasks." << std::endl;
+        } else {
+            // only the wheel's candidates go through the queue
+            wheel_.forEachCandidate(first, max_number, [this](long long num) {
+                {
+                    std::lock_guard<std::mutex> lock(queue_mutex_);
+                    task_queue_.push(num);
+                }
+                queue_cv_.notify_one();
+            });
+
+            // tell threads we're done adding numbers
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                all_tasks_added_ = true;
+            }
+            std::cout << "Main thread finished producing tasks." << std::endl;
+            queue_cv_.notify_all();
+            stats_.addProducerNotifies(candidates + 1); // one per number, plus the final notify_all
+        }
+        if (stats_.enabled()) stats_.producerSpan(produce_start, Instrumentation::nowNs());
+
+        // wait for all worker threads to finish
+        workers.join();
+    }
+
+private:
+    long long threadCount() const { return kThreads > 0 ? kThreads : settings_.thread_count; }
+
+    // this runs in each thread - grabs numbers and hands the primes to the output policy
+    template <typename Output>
+    void findPrimes_Number(Output& output, int worker) {
+        const bool timed = stats_.enabled(); // INSTRUMENT: time every wait for work
+        if (scheduler_) {
+            NumberChunk chunk;
+            while (true) {
+                std::int64_t wait_start = timed ? Instrumentation::nowNs() : 0;
+                bool got = scheduler_->next(worker, chunk);
+                std::int64_t work_start = timed ? Instrumentation::nowNs() : 0;
+                if (timed) stats_.addWait(worker, wait_start, work_start);
+                if (!got) break;
+                wheel_.forEachCandidate(chunk.start, chunk.end, [&](long long num) {
+                    if (is_prime_(num)) output.onPrime(worker, num);
+                });
+                if (timed) {
+                    stats_.addCandidates(worker, wheel_.countCandidates(chunk.start, chunk.end));
+                    stats_.addWork(worker, work_start, Instrumentation::nowNs());
+                }
+            }
+            return;
+        }
+        if (ring_) {
+            long long num;
+            while (true) {
+                std::int64_t wait_start = timed ? Instrumentation::nowNs() : 0;
+                bool got = ring_->pop(num);
+                if (timed) stats_.addWait(worker, wait_start, Instrumentation::nowNs());
+                if (!got) break;
+                stats_.addCandidates(worker, 1);
+                if (is_prime_(num)) output.onPrime(worker, num);
+            }
+            return;
+        }
+
+        while (true) {
+            long long num_to_check;
+
+            // grab a number from the queue (thread-safe)
+            std::int64_t wait_start = timed ? Instrumentation::nowNs() : 0;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex_);
+                queue_cv_.wait(lock, [this] {
+                    return !task_queue_.empty() || all_tasks_added_;
+                });
+
+                if (task_queue_.empty() && all_tasks_added_) {
+                    lock.unlock();
+                    if (timed) stats_.addWait(worker, wait_start, Instrumentation::nowNs());
+                    return; // no more work to do
+                }
+
+                num_to_check = task_queue_.front();
+                task_queue_.pop();
+            } // unlock the queue
+            if (timed) {
+                stats_.addWait(worker, wait_start, Instrumentation::nowNs());
+                stats_.addCandidates(worker, 1);
+            }
+
+            // do the actual work (check if prime)
+            if (is_prime_(num_to_check)) {
+                output.onPrime(worker, num_to_check);
+            }
+        }
+    }
+
+    const SearchSettings& settings_;
+    ThreadPlacement placement_;
+    PrimalityTest is_prime_;
+    Wheel wheel_; // WHEEL: which numbers the producer hands out at all
+
+    // shared stuff for the producer-consumer pattern (SCHEDULER=queue)
+    std::queue<long long> task_queue_;
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::atomic<bool> all_tasks_added_{false};
+
+    std::unique_ptr<WorkStealingScheduler> scheduler_; // SCHEDULER=stealing
+    std::unique_ptr<MpmcRing<long long>> ring_;        // SCHEDULER=ring
+    Instrumentation& stats_ = Instrumentation::get();
+};
+
+using RangeDivision = BasicRangeDivision<kFixedThreadCount, kFixedAlgorithm>;
+using NumberDivision = BasicNumberDivision<kFixedThreadCount>;
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// checks if a number is prime (basic 6k +/- 1 trial division)
+inline bool isPrimeTrialDivision(long long n) {
+    if (n <= 1) return false;
+    if (n <= 3) return true;
+    if (n % 2 == 0 || n % 3 == 0) return false;
+    for (long long i = 5; i * i <= n; i = i + 6) {
+        if (n % i == 0 || n % (i + 2) == 0)
+            return false;
+    }
+    return true;
+}
+
+// --- Deterministic Miller-Rabin for 64-bit inputs ---
+
+// Montgomery arithmetic modulo an odd 64-bit n, using 128-bit products.
+// Numbers are kept in Montgomery form (a * 2^64 mod n) so every modular
+// multiplication is two multiplies and a subtraction instead of a division.
+class Montgomery64 {
+public:
+    explicit Montgomery64(std::uint64_t n) : n_(n) {
+        // n^-1 mod 2^64 by Newton's iteration (each step doubles the correct bits)
+        inv_ = n;
+        for (int i = 0; i < 5; ++i) inv_ *= 2 - n * inv_;
+        std::uint64_t r = (0 - n) % n; // 2^64 mod n
+        r2_ = static_cast<std::uint64_t>((static_cast<unsigned __int128>(r) * r) % n);
+    }
+
+    std::uint64_t toMont(std::uint64_t a) const { return mul(a % n_, r2_); }
+    std::uint64_t one() const { return toMont(1); }
+
+    std::uint64_t mul(std::uint64_t a, std::uint64_t b) const {
+        return reduce(static_cast<unsigned __int128>(a) * b);
+    }
+
+    std::uint64_t pow(std::uint64_t base, std::uint64_t exp) const {
+        std::uint64_t result = one();
+        while (exp) {
+            if (exp & 1) result = mul(result, base);
+            base = mul(base, base);
+            exp >>= 1;
+        }
+        return result;
+    }
+
+private:
+    // t * 2^-64 mod n
+    std::uint64_t reduce(unsigned __int128 t) const {
+        std::uint64_t m = static_cast<std::uint64_t>(t) * inv_;
+        std::uint64_t hi = static_cast<std::uint64_t>(t >> 64);
+        std::uint64_t mn = static_cast<std::uint64_t>((static_cast<unsigned __int128>(m) * n_) >> 64);
+        return hi >= mn ? hi - mn : hi - mn + n_;
+    }
+
+    std::uint64_t n_;
+    std::uint64_t inv_;
+    std::uint64_t r2_;
+};
+
+// Miller-Rabin with the 7 bases known to be deterministic for every n < 2^64,
+// behind a quick trial division by the first few primes
+inline bool isPrimeMillerRabin(long long value) {
+    if (value < 2) return false;
+    std::uint64_t n = static_cast<std::uint64_t>(value);
+
+    static const std::uint32_t kSmallPrimes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47};
+    for (std::uint32_t p : kSmallPrimes) {
+        if (n == p) return true;
+        if (n % p == 0) return false;
+    }
+    if (n < 53 * 53) return true; // no factor below 53
+
+    // n - 1 = d * 2^s with d odd
+    std::uint64_t d = n - 1;
+    int s = 0;
+    while ((d & 1) == 0) {
+        d >>= 1;
+        ++s;
+    }
+
+    Montgomery64 mont(n);
+    const std::uint64_t one = mont.one();
+    const std::uint64_t minus_one = mont.toMont(n - 1);
+
+    static const std::uint64_t kWitnesses[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+    for (std::uint64_t a : kWitnesses) {
+        if (a % n == 0) continue;
+        std::uint64_t x = mont.pow(mont.toMont(a), d);
+        if (x == one || x == minus_one) continue;
+        bool composite = true;
+        for (int r = 1; r < s; ++r) {
+            x = mont.mul(x, x);
+            if (x == minus_one) {
+                composite = false;
+                break;
+            }
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+// --- Choosing a backend ---
+
+// below this trial division is cheaper than the fixed cost of Miller-Rabin
+// (the two cross over between 2^19 and 2^20)
+constexpr long long kDefaultMillerRabinThreshold = 1LL << 20;
+
+// the per-number test used by the worker threads, picked from PRIMALITY in the config
+class PrimalityTest {
+public:
+    enum class Mode { Auto, Trial, MillerRabin };
+
+    PrimalityTest(Mode mode = Mode::Auto, long long threshold = kDefaultMillerRabinThreshold)
+        : mode_(mode), threshold_(threshold) {}
+
+    // "auto", "trial" or "miller-rabin"; false if the name is unknown
+    static bool parseMode(const std::string& name, Mode& mode) {
+        if (name == "auto") mode = Mode::Auto;
+        else if (name == "trial") mode = Mode::Trial;
+        else if (name == "miller-rabin") mode = Mode::MillerRabin;
+        else return false;
+        return true;
+    }
+
+    // true if n would be checked by trial division (so a batched trial kernel may take it)
+    bool usesTrialDivision(long long n) const {
+        return mode_ == Mode::Trial || (mode_ == Mode::Auto && n < threshold_);
+    }
+
+    bool operator()(long long n) const {
+        switch (mode_) {
+            case Mode::Trial: return isPrimeTrialDivision(n);
+            case Mode::MillerRabin: return isPrimeMillerRabin(n);
+            default: return n < threshold_ ? isPrimeTrialDivision(n) : isPrimeMillerRabin(n);
+        }
+    }
+
+private:
+    Mode mode_;
+    long long threshold_;
+};
+
+// builds the per-number test from the PRIMALITY / MILLER_RABIN_THRESHOLD settings and says which one it is
+inline PrimalityTest makePrimalityTest(const std::string& name, long long threshold, std::ostream& out) {
+    PrimalityTest::Mode mode = PrimalityTest::Mode::Auto;
+    std::string used = name;
+    if (!PrimalityTest::parseMode(name, mode)) {
+        std::cerr << "Unknown PRIMALITY '" << name << "', using auto." << std::endl;
+        used = "auto";
+    }
+    out << "Primality test: " << used;
+    if (mode == PrimalityTest::Mode::Auto) out << " (Miller-Rabin from " << threshold << ")";
+    out << std::endl;
+    return PrimalityTest(mode, threshold);
+}
@@ -0,0 +1,405 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Binary result file (RESULT_FILE=...): all primes of a run, ascending, in a
+// form another program can mmap and query without parsing text.
+//
+// Layout (little-endian, every field fixed size):
+//   PrimeFileHeader                      - 64 bytes at offset 0
+//   segment data, back to back           - one blob per segment
+//   PrimeFileSegment[segment_count]      - the index, at header.index_offset
+//
+// Each segment covers the numbers [lo, hi] and is stored whichever way is
+// smaller:
+//   delta  - varint (p - lo) for the first prime, then varint gaps
+//   bitmap - one bit per odd number in [lo, hi] (a mod-2 wheel); never used
+//            for a segment that contains 2
+// The index keeps how many primes come before each segment, so "nth prime"
+// and "primes in [a, b]" only decode the segments they need.
+
+constexpr char kPrimeFileMagic[8] = {'P', '1', 'P', 'R', 'I', 'M', 'E', 'S'};
+constexpr std::uint32_t kPrimeFileVersion = 1;
+
+enum class SegmentEncoding : std::uint32_t { Delta = 0, Bitmap = 1 };
+
+struct PrimeFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::int64_t first;           // numbers covered: [first, last]
+    std::int64_t last;
+    std::uint64_t segment_count;
+    std::uint64_t total_primes;
+    std::uint64_t index_offset;   // where the PrimeFileSegment array starts
+    std::uint64_t reserved;
+};
+static_assert(sizeof(PrimeFileHeader) == 64, "header layout changed");
+
+struct PrimeFileSegment {
+    std::int64_t lo;
+    std::int64_t hi;
+    std::uint64_t rank;           // primes in all earlier segments
+    std::uint64_t count;
+    std::uint64_t offset;         // data blob position in the file
+    std::uint64_t bytes;
+    std::uint32_t encoding;       // SegmentEncoding
+    std::uint32_t reserved;
+};
+static_assert(sizeof(PrimeFileSegment) == 56, "index entry layout changed");
+
+// --- Writing ---
+
+// encodes one segment's primes, the smaller of delta and bitmap
+// (shared by the result file and the sieve cache)
+class PrimeSegmentEncoder {
+public:
+    // returns the encoded bytes of the (ascending) primes of [lo, hi]
+    const std::vector<std::uint8_t>& encode(long long lo, long long hi, const long long* primes, std::size_t count,
+                                            SegmentEncoding& encoding) {
+        encodeDelta(lo, primes, count);
+        bool use_bitmap = (lo > 2) && encodeBitmap(lo, hi, primes, count);
+        encoding = use_bitmap ? SegmentEncoding::Bitmap : SegmentEncoding::Delta;
+        return use_bitmap ? bitmap_ : bytes_;
+    }
+
+private:
+    static void putVarint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    void encodeDelta(long long lo, const long long* primes, std::size_t count) {
+        bytes_.clear();
+        long long previous = lo;
+        for (std::size_t i = 0; i < count; ++i) {
+            putVarint(bytes_, static_cast<std::uint64_t>(primes[i] - previous));
+            previous = primes[i];
+        }
+    }
+
+    // false if the bitmap would not beat the delta encoding anyway
+    bool encodeBitmap(long long lo, long long hi, const long long* primes, std::size_t count) {
+        long long base = lo | 1;
+        std::size_t odd_count = (hi >= base) ? static_cast<std::size_t>((hi - base) / 2 + 1) : 0;
+        std::size_t size = (odd_count + 7) / 8;
+        if (size >= bytes_.size()) return false;
+        bitmap_.assign(size, 0);
+        for (std::size_t i = 0; i < count; ++i) {
+            std::size_t bit = static_cast<std::size_t>((primes[i] - base) / 2);
+            bitmap_[bit / 8] |= static_cast<std::uint8_t>(1u << (bit % 8));
+        }
+        return true;
+    }
+
+    std::vector<std::uint8_t> bytes_;   // delta encoding of the current segment
+    std::vector<std::uint8_t> bitmap_;  // bitmap encoding of the current segment
+};
+
+class PrimeFileWriter {
+public:
+    ~PrimeFileWriter() {
+        if (file_) std::fclose(file_);
+    }
+
+    // creates the file; segments must then be added in ascending order
+    bool open(const std::string& path, long long first) {
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) return false;
+        std::memset(&header_, 0, sizeof(header_));
+        std::memcpy(header_.magic, kPrimeFileMagic, sizeof(kPrimeFileMagic));
+        header_.version = kPrimeFileVersion;
+        header_.header_size = sizeof(PrimeFileHeader);
+        header_.first = first;
+        header_.last = first - 1;
+        offset_ = sizeof(PrimeFileHeader);
+        // real header is written by finish(), once the index position is known
+        return std::fwrite(&header_, sizeof(header_), 1, file_) == 1;
+    }
+
+    // appends the (ascending) primes of the numbers [lo, hi]
+    bool addSegment(long long lo, long long hi, const long long* primes, std::size_t count) {
+        SegmentEncoding encoding;
+        const std::vector<std::uint8_t>& data = encoder_.encode(lo, hi, primes, count, encoding);
+        return addEncodedSegment(lo, hi, count, encoding, data.data(), data.size());
+    }
+
+    bool addSegment(long long lo, long long hi, const std::vector<long long>& primes) {
+        return addSegment(lo, hi, primes.data(), primes.size());
+    }
+
+    // appends a segment that is already encoded (see PrimeSegmentEncoder),
+    // e.g. one that came from a cluster worker
+    bool addEncodedSegment(long long lo, long long hi, std::uint64_t count, SegmentEncoding encoding,
+                           const std::uint8_t* data, std::size_t bytes) {
+        PrimeFileSegment entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.lo = lo;
+        entry.hi = hi;
+        entry.rank = header_.total_primes;
+        entry.count = count;
+        entry.offset = offset_;
+        entry.bytes = bytes;
+        entry.encoding = static_cast<std::uint32_t>(encoding);
+        index_.push_back(entry);
+
+        if (bytes && std::fwrite(data, 1, bytes, file_) != bytes) return false;
+        offset_ += bytes;
+        header_.total_primes += count;
+        header_.last = hi;
+        return true;
+    }
+
+    // writes the index and the final header, then closes the file
+    bool finish() {
+        if (!file_) return false;
+        // the index is read in place from the mapping, so keep it 8-byte aligned
+        static const std::uint8_t kPadding[8] = {};
+        std::size_t padding = static_cast<std::size_t>((8 - offset_ % 8) % 8);
+        if (padding && std::fwrite(kPadding, 1, padding, file_) != padding) return false;
+        offset_ += padding;
+        header_.segment_count = index_.size();
+        header_.index_offset = offset_;
+        bool ok = index_.empty() || std::fwrite(index_.data(), sizeof(PrimeFileSegment), index_.size(), file_) == index_.size();
+        ok = ok && std::fseek(file_, 0, SEEK_SET) == 0 && std::fwrite(&header_, sizeof(header_), 1, file_) == 1;
+        ok = (std::fclose(file_) == 0) && ok;
+        file_ = nullptr;
+        return ok;
+    }
+
+    std::size_t segmentCount() const { return index_.size(); }
+    std::uint64_t fileBytes() const { return offset_ + index_.size() * sizeof(PrimeFileSegment); }
+
+private:
+    std::FILE* file_ = nullptr;
+    PrimeFileHeader header_;
+    std::uint64_t offset_ = 0;
+    std::vector<PrimeFileSegment> index_;
+    PrimeSegmentEncoder encoder_;
+};
+
+// --- Reading ---
+
+// read-only memory map of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+#if defined(_WIN32)
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) return false;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) return false;
+        data_ = static_cast<const std::uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        size_ = static_cast<std::size_t>(size.QuadPart);
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) return false;
+        struct stat st;
+        if (fstat(fd_, &st) != 0 || st.st_size == 0) return false;
+        void* p = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) return false;
+        data_ = static_cast<const std::uint8_t*>(p);
+        size_ = static_cast<std::size_t>(st.st_size);
+#endif
+        return data_ != nullptr;
+    }
+
+    void close() {
+#if defined(_WIN32)
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_) munmap(const_cast<std::uint8_t*>(data_), size_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const std::uint8_t* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const std::uint8_t* data_ = nullptr;
+    std::size_t size_ = 0;
+#if defined(_WIN32)
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// first entry of an ascending segment index with hi >= a (count if none)
+inline std::size_t firstSegmentAtOrAfter(const PrimeFileSegment* index, std::size_t count, long long a) {
+    std::size_t lo = 0, hi = count;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (index[mid].hi < a) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// calls fn(prime) for a segment's primes in order until fn returns false.
+// data/size is the whole mapped file, seg.offset points into it.
+template <typename Fn>
+void decodePrimeSegment(const std::uint8_t* data, std::size_t size, const PrimeFileSegment& seg, Fn&& fn) {
+    if (seg.offset > size || seg.bytes > size - seg.offset) return;
+    const std::uint8_t* p = data + seg.offset;
+    const std::uint8_t* end = p + seg.bytes;
+    if (seg.encoding == static_cast<std::uint32_t>(SegmentEncoding::Bitmap)) {
+        long long base = seg.lo | 1;
+        for (std::size_t i = 0; p + i < end; ++i) {
+            unsigned bits = p[i];
+            while (bits) {
+                int bit = __builtin_ctz(bits);
+                if (!fn(base + 2 * static_cast<long long>(i * 8 + bit))) return;
+                bits &= bits - 1;
+            }
+        }
+        return;
+    }
+    long long value = seg.lo;
+    while (p < end) {
+        std::uint64_t gap = 0;
+        int shift = 0;
+        while (p < end && (*p & 0x80)) {
+            gap |= static_cast<std::uint64_t>(*p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        if (p == end) return; // cut off in the middle of a number
+        gap |= static_cast<std::uint64_t>(*p++) << shift;
+        value += static_cast<long long>(gap);
+        if (!fn(value)) return;
+    }
+}
+
+// answers queries straight from a mapped result file
+class PrimeFileReader {
+public:
+    // maps the file and checks its header and index, false (with a reason) if it is not usable
+    bool open(const std::string& path, std::string& error) {
+        if (!file_.open(path)) {
+            error = "could not map " + path;
+            return false;
+        }
+        if (file_.size() < sizeof(PrimeFileHeader)) {
+            error = "file too small";
+            return false;
+        }
+        std::memcpy(&header_, file_.data(), sizeof(header_));
+        if (std::memcmp(header_.magic, kPrimeFileMagic, sizeof(kPrimeFileMagic)) != 0 || header_.version != kPrimeFileVersion) {
+            error = "not a prime result file (or a different version)";
+            return false;
+        }
+        if (header_.index_offset > file_.size() || header_.index_offset % 8 != 0
+            || header_.segment_count > (file_.size() - header_.index_offset) / sizeof(PrimeFileSegment)) {
+            error = "index is truncated";
+            return false;
+        }
+        index_ = reinterpret_cast<const PrimeFileSegment*>(file_.data() + header_.index_offset);
+        return true;
+    }
+
+    long long first() const { return header_.first; }
+    long long last() const { return header_.last; }
+    std::uint64_t totalPrimes() const { return header_.total_primes; }
+    std::uint64_t segmentCount() const { return header_.segment_count; }
+
+    // the n-th prime in the file (1-based), false if there are fewer than n
+    bool nthPrime(std::uint64_t n, long long& prime) const {
+        if (n < 1 || n > header_.total_primes) return false;
+        // last segment whose rank is below n
+        std::size_t lo = 0, hi = static_cast<std::size_t>(header_.segment_count);
+        while (hi - lo > 1) {
+            std::size_t mid = lo + (hi - lo) / 2;
+            if (index_[mid].rank < n) lo = mid;
+            else hi = mid;
+        }
+        std::uint64_t want = n - index_[lo].rank; // 1-based within the segment
+        std::uint64_t seen = 0;
+        decodeSegment(index_[lo], [&](long long p) {
+            if (++seen == want) {
+                prime = p;
+                return false;
+            }
+            return true;
+        });
+        return seen == want;
+    }
+
+    // calls fn(prime) for every prime in [a, b], ascending
+    template <typename Fn>
+    void forEachInRange(long long a, long long b, Fn&& fn) const {
+        for (std::size_t s = firstSegmentAtOrAfter(a); s < header_.segment_count && index_[s].lo <= b; ++s) {
+            decodeSegment(index_[s], [&](long long p) {
+                if (p > b) return false;
+                if (p >= a) fn(p);
+                return true;
+            });
+        }
+    }
+
+    // how many primes are in [a, b] (whole segments inside the range are not decoded)
+    std::uint64_t countInRange(long long a, long long b) const {
+        std::uint64_t count = 0;
+        for (std::size_t s = firstSegmentAtOrAfter(a); s < header_.segment_count && index_[s].lo <= b; ++s) {
+            if (index_[s].lo >= a && index_[s].hi <= b) {
+                count += index_[s].count;
+                continue;
+            }
+            decodeSegment(index_[s], [&](long long p) {
+                if (p > b) return false;
+                if (p >= a) ++count;
+                return true;
+            });
+        }
+        return count;
+    }
+
+private:
+    std::size_t firstSegmentAtOrAfter(long long a) const {
+        return ::firstSegmentAtOrAfter(index_, static_cast<std::size_t>(header_.segment_count), a);
+    }
+
+    template <typename Fn>
+    void decodeSegment(const PrimeFileSegment& seg, Fn&& fn) const {
+        decodePrimeSegment(file_.data(), file_.size(), seg, fn);
+    }
+
+    MappedFile file_;
+    PrimeFileHeader header_{};
+    const PrimeFileSegment* index_ = nullptr;
+};
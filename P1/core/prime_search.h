@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+#include "config.h"
+#include "instrumentation.h"
+#include "output_policy.h"
+#include "partition_policy.h"
+#include "timestamp.h"
+
+// Prime search library: one run = a partitioning policy (how numbers are
+// split between threads) x an output policy (what happens to each prime).
+// Both are template parameters, so each of the four variants is its own
+// fully inlined instantiation with no virtual calls in the worker loops:
+//
+//   Variant 1: runPrimeSearch<RangeDivision,  ImmediatePrint>
+//   Variant 2: runPrimeSearch<RangeDivision,  BatchedPrint>
+//   Variant 3: runPrimeSearch<NumberDivision, ImmediatePrint>
+//   Variant 4: runPrimeSearch<NumberDivision, BatchedPrint>
+
+// runs the workers and prints the summary for one partition/output pair
+template <typename Partition, typename Output>
+int runSearchWith(const SearchSettings& settings, std::chrono::high_resolution_clock::time_point start_time) {
+    Instrumentation::get().begin(settings);
+    Partition partition(settings);
+    Output output(settings);
+    partition.run(output);
+    output.workersDone();
+
+    // stop timer and see how long it took
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+
+    output.printResults();
+    std::cout << "Run END: " << getCurrentTimestamp() << std::endl;
+    std::cout << "Total execution time: " << duration.count() << " ms" << std::endl;
+    long long numbers = (settings.min_number > 2) ? settings.max_number - settings.min_number + 1 : settings.max_number;
+    std::cout << "Performance: " << numbers << " numbers processed in " << duration.count() << " ms" << std::endl;
+    Instrumentation::get().printSummary();
+    return 0;
+}
+
+// runs one search with already loaded settings (used by runPrimeSearch and the benchmark)
+template <typename Partition, typename Output>
+int runSearch(const SearchSettings& settings, std::chrono::high_resolution_clock::time_point start_time) {
+    if constexpr (kFixedBuild) {
+        // the partition policies are compiled for one THREAD_COUNT / ALGORITHM
+        if (!matchesFixedBuild(settings)) {
+            SearchSettings fixed = settings;
+            applyFixedBuild(fixed);
+            return runSearch<Partition, Output>(fixed, start_time);
+        }
+    }
+    // BATCH_OUTPUT=stream swaps batched print for its bounded-memory streaming form.
+    // CACHE_FILE works on the streamed segments, so it turns streaming on too.
+    constexpr bool can_stream = std::is_same_v<Output, BatchedPrint> && Partition::kSupportsStreaming;
+    if (!settings.cache_file.empty() && !can_stream) {
+        std::cerr << "CACHE_FILE needs range division with batched print (variant 2), ignoring it." << std::endl;
+    }
+    if constexpr (std::is_same_v<Output, BatchedPrint>) {
+        if (settings.batch_output == "stream" || (can_stream && !settings.cache_file.empty())) {
+            if constexpr (Partition::kSupportsStreaming) {
+                return runSearchWith<Partition, StreamingPrint>(settings, start_time);
+            } else {
+                std::cerr << "BATCH_OUTPUT=stream needs range division, printing all at the end." << std::endl;
+            }
+        } else if (settings.batch_output != "all") {
+            std::cerr << "Unknown BATCH_OUTPUT '" << settings.batch_output << "', printing all at the end." << std::endl;
+        }
+    }
+    return runSearchWith<Partition, Output>(settings, start_time);
+}
+
+// argv holds the program's own arguments (a config path and/or --KEY=value
+// flags, see loadSettings); default_config is used when none is named
+template <typename Partition, typename Output>
+int runPrimeSearch(int variant_number, const std::string& default_config, int argc = 0, char* argv[] = nullptr) {
+    std::cout << "--- Variant " << variant_number << ": " << Partition::kName << " / " << Output::kName << " ---" << std::endl;
+
+    // start the timer
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::cout << "Run START: " << getCurrentTimestamp() << std::endl;
+
+    // load settings from the config file, environment and command line
+    SearchSettings settings;
+    if (!loadSettings(argc, argv, default_config, settings)) {
+        std::cerr << "Config file missing or incomplete. Exiting." << std::endl;
+        return 1;
+    }
+    if (settings.thread_count < 1) {
+        std::cerr << "THREAD_COUNT must be at least 1. Exiting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Config: Using " << settings.thread_count << " threads to search up to " << settings.max_number << "." << std::endl;
+    return runSearch<Partition, Output>(settings, start_time);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// How range division cuts [first, last] into one range per thread
+// (RANGE_SPLIT in the config):
+//   equal   - same number of numbers per thread (the original split)
+//   cost    - same estimated work per thread, from a cost-per-number model
+//   dynamic - no fixed ranges, threads claim RANGE_CHUNK numbers at a time
+//             from a shared atomic cursor (see RangeDivision)
+
+// Rough cost of testing one number around n, in nanoseconds on a desktop
+// x86 core (only the ratios matter, fitted from timing both tests).
+// Trial division: every number pays a fixed cost to get past 2 and 3, the
+// primes (about 1 in ln n) then run the whole 6k +/- 1 loop up to sqrt n.
+inline double trialDivisionCost(double n) {
+    if (n < 3) return 45.0;
+    return 45.0 + 1.4 * std::sqrt(n) / std::log(n);
+}
+
+// Miller-Rabin: the prefilter throws most numbers out, the rest cost one
+// exponentiation (composites) or seven (primes), so it barely grows with n
+inline double millerRabinCost(double n) {
+    if (n < 3) return 80.0;
+    return 80.0 + std::log2(n);
+}
+
+// Cuts [first, last] into parts ranges of about equal total cost.
+// Returns parts + 1 bounds: range i is [bounds[i] + 1, bounds[i + 1]]
+// (bounds[0] = first - 1, bounds[parts] = last, empty if two are equal), so
+// no bound is ever past last - it can be LLONG_MAX (first must be >= 1).
+// cost(n) is integrated numerically, so any smooth-ish model works.
+template <typename CostFn>
+std::vector<long long> costBalancedBounds(long long first, long long last, int parts, CostFn&& cost) {
+    std::vector<long long> bounds(static_cast<std::size_t>(parts) + 1, last);
+    bounds[0] = first - 1;
+    if (parts < 1 || last < first) return bounds;
+
+    // cumulative cost at kSteps + 1 evenly spaced points (trapezoid rule)
+    const int kSteps = 4096;
+    double span = static_cast<double>(last - first) + 1;
+    double step = span / kSteps;
+    std::vector<double> cumulative(kSteps + 1, 0.0);
+    double previous = cost(static_cast<double>(first));
+    for (int s = 1; s <= kSteps; ++s) {
+        double current = cost(first + s * step);
+        cumulative[s] = cumulative[s - 1] + (previous + current) / 2 * step;
+        previous = current;
+    }
+
+    // bound i is where the cumulative cost reaches i / parts of the total
+    int s = 0;
+    for (int i = 1; i < parts; ++i) {
+        double target = cumulative[kSteps] * i / parts;
+        while (s < kSteps && cumulative[s + 1] < target) ++s;
+        double in_step = cumulative[s + 1] - cumulative[s];
+        double frac = (in_step > 0) ? (target - cumulative[s]) / in_step : 0;
+        // numbers before the cut (clamped in double, so the cast can't overflow)
+        double before = (s + frac) * step;
+        long long bound = (before >= static_cast<double>(last - first)) ? last : first - 1 + static_cast<long long>(before);
+        if (bound < bounds[i - 1]) bound = bounds[i - 1];
+        bounds[i] = bound;
+    }
+    return bounds;
+}
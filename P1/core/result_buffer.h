@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Per-thread storage for the primes a batched worker finds.
+// - each buffer sits on its own cache line(s), so threads pushing into
+//   neighbouring buffers don't false-share the vector headers
+// - storage is reserved up front from a prime-counting estimate, so it
+//   doesn't keep reallocating while the thread runs
+// - primes can be kept as raw long longs, as 32-bit gaps, or as a bitmap of
+//   the odd numbers in the thread's range, to keep huge runs in memory
+
+enum class ResultEncoding { Raw, Delta32, Bitset };
+
+inline const char* resultEncodingName(ResultEncoding encoding) {
+    switch (encoding) {
+        case ResultEncoding::Delta32: return "delta32";
+        case ResultEncoding::Bitset: return "bitset";
+        default: return "raw";
+    }
+}
+
+// "raw", "delta32" or "bitset"; false if the name is unknown
+inline bool parseResultEncoding(const std::string& name, ResultEncoding& encoding) {
+    if (name == "raw") encoding = ResultEncoding::Raw;
+    else if (name == "delta32") encoding = ResultEncoding::Delta32;
+    else if (name == "bitset") encoding = ResultEncoding::Bitset;
+    else return false;
+    return true;
+}
+
+// about how many primes are <= x (x / (ln x - 1), slightly high for large x)
+inline double primeCountEstimate(long long x) {
+    if (x < 2) return 0;
+    if (x < 100) return 25;
+    double fx = static_cast<double>(x);
+    return fx / (std::log(fx) - 1.0);
+}
+
+// about how many primes are in [lo, hi], with a little slack on top
+inline std::size_t primesInRangeEstimate(long long lo, long long hi) {
+    if (hi < lo) return 0;
+    double estimate = primeCountEstimate(hi) - primeCountEstimate(lo - 1);
+    if (estimate < 0) estimate = 0;
+    return static_cast<std::size_t>(estimate * 1.02) + 16;
+}
+
+class alignas(64) PrimeResultBuffer {
+public:
+    // sets the encoding and reserves room for expected primes from [lo, hi]
+    void init(ResultEncoding encoding, long long lo, long long hi, std::size_t expected) {
+        encoding_ = encoding;
+        if (encoding_ == ResultEncoding::Bitset) {
+            // one bit per odd number in the range (2 gets its own flag)
+            base_ = (lo % 2 == 0) ? lo + 1 : lo;
+            if (base_ < 3) base_ = 3;
+            long long odd_count = (hi >= base_) ? (hi - base_) / 2 + 1 : 0;
+            limit_ = hi;
+            bits_.assign(static_cast<std::size_t>((odd_count + 63) / 64), 0);
+        } else if (encoding_ == ResultEncoding::Delta32) {
+            deltas_.reserve(expected);
+        } else {
+            raw_.reserve(expected);
+        }
+    }
+
+    void push(long long prime) {
+        ++count_;
+        switch (encoding_) {
+            case ResultEncoding::Bitset:
+                if (prime == 2) {
+                    has_two_ = true;
+                } else if (prime >= base_ && prime <= limit_) {
+                    std::size_t idx = static_cast<std::size_t>((prime - base_) / 2);
+                    bits_[idx / 64] |= 1ULL << (idx % 64);
+                } else {
+                    raw_.push_back(prime); // outside the range we were told about
+                }
+                break;
+            case ResultEncoding::Delta32: {
+                long long gap = prime - last_;
+                if (gap > 0 && gap <= 0xFFFFFFFFLL) {
+                    deltas_.push_back(static_cast<std::uint32_t>(gap));
+                } else {
+                    // went backwards or jumped too far: 0 (never a real gap) + the full value
+                    deltas_.push_back(0);
+                    deltas_.push_back(static_cast<std::uint32_t>(static_cast<unsigned long long>(prime) >> 32));
+                    deltas_.push_back(static_cast<std::uint32_t>(prime));
+                }
+                last_ = prime;
+                break;
+            }
+            default:
+                raw_.push_back(prime);
+        }
+    }
+
+    std::size_t size() const { return count_; }
+
+    // calls fn(prime) for every stored prime, in the order they were pushed
+    // (bitset: ascending, which is the same thing for a range thread)
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        switch (encoding_) {
+            case ResultEncoding::Bitset:
+                if (has_two_) fn(2LL);
+                for (std::size_t w = 0; w < bits_.size(); ++w) {
+                    std::uint64_t word = bits_[w];
+                    while (word) {
+                        int bit = ctz64(word);
+                        fn(base_ + 2 * static_cast<long long>(w * 64 + bit));
+                        word &= word - 1;
+                    }
+                }
+                for (long long prime : raw_) fn(prime);
+                break;
+            case ResultEncoding::Delta32: {
+                long long value = 0;
+                for (std::size_t i = 0; i < deltas_.size(); ++i) {
+                    if (deltas_[i] != 0) {
+                        value += deltas_[i];
+                    } else {
+                        value = static_cast<long long>((static_cast<unsigned long long>(deltas_[i + 1]) << 32) | deltas_[i + 2]);
+                        i += 2;
+                    }
+                    fn(value);
+                }
+                break;
+            }
+            default:
+                for (long long prime : raw_) fn(prime);
+        }
+    }
+
+    // bytes actually held by this buffer
+    std::size_t memoryBytes() const {
+        return raw_.capacity() * sizeof(long long) + deltas_.capacity() * sizeof(std::uint32_t)
+             + bits_.capacity() * sizeof(std::uint64_t) + sizeof(*this);
+    }
+
+private:
+    static int ctz64(std::uint64_t x) {
+    #if defined(__GNUC__)
+        return __builtin_ctzll(x);
+    #else
+        int n = 0;
+        while (!(x & 1)) { x >>= 1; ++n; }
+        return n;
+    #endif
+    }
+
+    ResultEncoding encoding_ = ResultEncoding::Raw;
+    std::size_t count_ = 0;
+
+    std::vector<long long> raw_;          // raw (and bitset overflow)
+    std::vector<std::uint32_t> deltas_;   // delta32
+    long long last_ = 0;
+
+    std::vector<std::uint64_t> bits_;     // bitset over odd numbers base_..limit_
+    long long base_ = 3;
+    long long limit_ = 0;
+    bool has_two_ = false;
+};
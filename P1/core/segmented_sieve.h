@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Segmented Sieve of Eratosthenes.
+// The base primes (up to sqrt(max_number)) are computed once and shared
+// read-only by every thread. Each thread then sieves its own range in small
+// segments so the working buffer stays inside L1/L2 cache.
+
+// 32 KiB of odd numbers per segment (fits a typical L1 data cache)
+constexpr std::size_t kDefaultSegmentBytes = 32 * 1024;
+
+// integer square root (floor), for any n in the long long range
+inline long long isqrtFloor(long long n) {
+    if (n < 2) return n;
+    long long r = 0;
+    long long bit = 1LL << 62;
+    while (bit > n) bit >>= 2;
+    while (bit != 0) {
+        if (n >= r + bit) {
+            n -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+class SegmentedSieve {
+public:
+    explicit SegmentedSieve(long long max_number, std::size_t segment_bytes = kDefaultSegmentBytes)
+        : max_number_(max_number), segment_bytes_(segment_bytes < 64 ? 64 : segment_bytes) {
+        buildBasePrimes(isqrtFloor(max_number));
+    }
+
+    long long maxNumber() const { return max_number_; }
+    std::size_t segmentBytes() const { return segment_bytes_; }
+
+    // calls on_prime(p) for every prime p in [start, end], in ascending order;
+    // end may be LLONG_MAX (no step computes past it).
+    // safe to call from many threads at once (only reads shared state).
+    template <typename OnPrime>
+    void forEachPrime(long long start, long long end, OnPrime&& on_prime) const {
+        if (end > max_number_) end = max_number_;
+        if (start < 2) start = 2;
+        if (start > end) return;
+
+        if (start == 2) {
+            on_prime(2LL);
+            start = 3;
+        }
+        if (start % 2 == 0) ++start; // segments only hold odd numbers
+        if (start > end) return;
+
+        // this thread's own segment buffer, one byte per odd number
+        std::vector<std::uint8_t> segment(segment_bytes_);
+        const long long span = 2 * static_cast<long long>(segment_bytes_ - 1);
+
+        for (long long seg_lo = start; seg_lo <= end;) {
+            long long seg_hi = (end - seg_lo > span) ? seg_lo + span : end;
+            std::size_t count = static_cast<std::size_t>((seg_hi - seg_lo) / 2 + 1);
+            std::fill(segment.begin(), segment.begin() + count, 1);
+
+            for (std::uint32_t bp : base_primes_) {
+                long long p = bp;
+                if (p * p > seg_hi) break;
+                // first odd multiple of p inside the segment (but never p itself);
+                // rounded up without seg_lo + p, which overflows near LLONG_MAX
+                long long m = seg_lo / p * p;
+                if (m < seg_lo) {
+                    if (m > seg_hi - p) continue;
+                    m += p;
+                }
+                if (m < p * p) m = p * p;
+                if (m % 2 == 0) {
+                    if (m > seg_hi - p) continue;
+                    m += p;
+                }
+                for (std::size_t j = static_cast<std::size_t>((m - seg_lo) / 2); j < count; j += p) {
+                    segment[j] = 0;
+                }
+            }
+
+            for (std::size_t j = 0; j < count; ++j) {
+                if (segment[j]) on_prime(seg_lo + 2 * static_cast<long long>(j));
+            }
+
+            if (seg_hi == end) break;
+            seg_lo = seg_hi + 2;
+        }
+    }
+
+private:
+    // simple sieve for the odd base primes up to limit
+    void buildBasePrimes(long long limit) {
+        if (limit < 3) return;
+        std::vector<bool> composite(static_cast<std::size_t>(limit) + 1, false);
+        for (long long i = 3; i * i <= limit; i += 2) {
+            if (composite[i]) continue;
+            for (long long j = i * i; j <= limit; j += 2 * i) composite[j] = true;
+        }
+        for (long long i = 3; i <= limit; i += 2) {
+            if (!composite[i]) base_primes_.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    long long max_number_;
+    std::size_t segment_bytes_;
+    std::vector<std::uint32_t> base_primes_; // odd primes <= sqrt(max_number)
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "prime_file.h"
+
+// Persistent cache of the primes in [2, last] (CACHE_FILE=...), shared by
+// every run that points at the same file.
+// The file is an append-only log, so it is safe against crashes:
+//   SieveCacheHeader                                 - 64 bytes at offset 0
+//   then one record per segment, ascending and contiguous from 2:
+//     PrimeFileSegment | encoded primes | uint64 checksum
+// A record only counts once its checksum matches, so a run that died while
+// writing loses at most the segment it was on. The next run maps the good
+// records, reuses them and appends after the last one.
+
+constexpr char kSieveCacheMagic[8] = {'P', '1', 'S', 'I', 'E', 'V', 'E', 'C'};
+constexpr std::uint32_t kSieveCacheVersion = 1;
+
+struct SieveCacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint8_t reserved[48];
+};
+static_assert(sizeof(SieveCacheHeader) == 64, "cache header layout changed");
+
+// FNV-1a, enough to tell a complete record from a torn one
+inline std::uint64_t cacheChecksum(const void* data, std::size_t size, std::uint64_t hash = 1469598103934665603ULL) {
+    const std::uint8_t* p = static_cast<const std::uint8_t*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// 64-bit safe fseek (the cache can pass 2 GB)
+inline bool seekFile(std::FILE* file, std::uint64_t pos) {
+#if defined(_WIN32)
+    return _fseeki64(file, static_cast<long long>(pos), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(pos), SEEK_SET) == 0;
+#endif
+}
+
+class SieveCache {
+public:
+    ~SieveCache() {
+        if (file_) std::fclose(file_);
+    }
+
+    // maps whatever is already cached (a missing file is an empty cache) and opens it for appending
+    bool open(const std::string& path, std::string& error) {
+        std::uint64_t valid_end = 0;
+        if (map_.open(path)) {
+            valid_end = loadRecords();
+            if (valid_end == 0) {
+                error = path + " is not a sieve cache";
+                return false;
+            }
+        }
+        if (valid_end == 0) {
+            // new cache: write the header first
+            file_ = std::fopen(path.c_str(), "wb");
+            if (!file_) {
+                error = "could not create " + path;
+                return false;
+            }
+            SieveCacheHeader header;
+            std::memset(&header, 0, sizeof(header));
+            std::memcpy(header.magic, kSieveCacheMagic, sizeof(kSieveCacheMagic));
+            header.version = kSieveCacheVersion;
+            header.header_size = sizeof(SieveCacheHeader);
+            if (std::fwrite(&header, sizeof(header), 1, file_) != 1 || std::fflush(file_) != 0) {
+                error = "could not write " + path;
+                return false;
+            }
+            valid_end = sizeof(SieveCacheHeader);
+        } else {
+            // append after the last good record (a torn one after it just gets overwritten)
+            file_ = std::fopen(path.c_str(), "r+b");
+            if (!file_ || !seekFile(file_, valid_end)) {
+                error = "could not open " + path + " for writing";
+                return false;
+            }
+        }
+        end_offset_ = valid_end;
+        mapped_last_ = last_;
+        return true;
+    }
+
+    // numbers [2, last()] are cached (1 when the cache is empty)
+    long long last() const { return last_; }
+    // what was already cached when the file was opened (the part forEachCached can read)
+    long long mappedLast() const { return mapped_last_; }
+    std::size_t mappedSegments() const { return records_.size(); }
+    std::size_t appendedSegments() const { return appended_; }
+
+    // calls fn(prime) for the cached primes in [a, b] (only up to mappedLast())
+    template <typename Fn>
+    void forEachCached(long long a, long long b, Fn&& fn) const {
+        for (std::size_t s = firstSegmentAtOrAfter(records_.data(), records_.size(), a);
+             s < records_.size() && records_[s].lo <= b; ++s) {
+            decodePrimeSegment(map_.data(), map_.size(), records_[s], [&](long long p) {
+                if (p > b) return false;
+                if (p >= a) fn(p);
+                return true;
+            });
+        }
+    }
+
+    // appends the (ascending) primes of [lo, hi]; lo must be last() + 1.
+    // flushed right away, so a crash after this keeps the segment.
+    bool append(long long lo, long long hi, const long long* primes, std::size_t count) {
+        if (!file_ || lo != last_ + 1 || hi < lo) return false;
+        SegmentEncoding encoding;
+        const std::vector<std::uint8_t>& data = encoder_.encode(lo, hi, primes, count, encoding);
+
+        PrimeFileSegment entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.lo = lo;
+        entry.hi = hi;
+        entry.rank = total_primes_;
+        entry.count = count;
+        entry.offset = end_offset_ + sizeof(PrimeFileSegment);
+        entry.bytes = data.size();
+        entry.encoding = static_cast<std::uint32_t>(encoding);
+        std::uint64_t check = cacheChecksum(data.data(), data.size(), cacheChecksum(&entry, sizeof(entry)));
+
+        bool ok = std::fwrite(&entry, sizeof(entry), 1, file_) == 1
+               && (data.empty() || std::fwrite(data.data(), 1, data.size(), file_) == data.size())
+               && std::fwrite(&check, sizeof(check), 1, file_) == 1
+               && std::fflush(file_) == 0;
+        if (!ok) return false;
+        end_offset_ += sizeof(entry) + data.size() + sizeof(check);
+        total_primes_ += count;
+        last_ = hi;
+        ++appended_;
+        return true;
+    }
+
+private:
+    // walks the mapped records, returns where the good ones end (0 if the header is wrong)
+    std::uint64_t loadRecords() {
+        const std::uint8_t* data = map_.data();
+        std::size_t size = map_.size();
+        if (size < sizeof(SieveCacheHeader)) return 0;
+        SieveCacheHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, kSieveCacheMagic, sizeof(kSieveCacheMagic)) != 0 || header.version != kSieveCacheVersion) {
+            return 0;
+        }
+
+        std::uint64_t pos = sizeof(SieveCacheHeader);
+        while (size - pos >= sizeof(PrimeFileSegment)) {
+            PrimeFileSegment entry;
+            std::memcpy(&entry, data + pos, sizeof(entry));
+            std::uint64_t blob = pos + sizeof(PrimeFileSegment);
+            if (entry.lo != last_ + 1 || entry.hi < entry.lo || entry.offset != blob
+                || entry.bytes > size - blob || size - blob - entry.bytes < sizeof(std::uint64_t)) {
+                break;
+            }
+            std::uint64_t check;
+            std::memcpy(&check, data + blob + entry.bytes, sizeof(check));
+            if (check != cacheChecksum(data + blob, static_cast<std::size_t>(entry.bytes), cacheChecksum(&entry, sizeof(entry)))) {
+                break; // torn write from a run that died
+            }
+            records_.push_back(entry);
+            total_primes_ += entry.count;
+            last_ = entry.hi;
+            pos = blob + entry.bytes + sizeof(std::uint64_t);
+        }
+        return pos;
+    }
+
+    MappedFile map_;
+    std::vector<PrimeFileSegment> records_;  // the mapped records, in order
+    std::FILE* file_ = nullptr;
+    std::uint64_t end_offset_ = 0;
+    std::uint64_t total_primes_ = 0;
+    long long last_ = 1;
+    long long mapped_last_ = 1;
+    std::size_t appended_ = 0;
+    PrimeSegmentEncoder encoder_;
+};
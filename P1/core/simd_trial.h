@@ -0,0 +1,257 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include "primality.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define PRIME_SIMD_X86 1
+    #include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    #define PRIME_SIMD_NEON 1
+    #include <arm_neon.h>
+#endif
+
+// Batched trial division: tests up to kTrialBatchSize candidates at once
+// against the same 6k +/- 1 divisor sequence, with one SIMD lane per
+// candidate. Work is done in double precision: q = round(n * (1/d)) is the
+// exact quotient whenever d divides n, and r = n - q*d (one fused
+// multiply-add, so no rounding) is zero exactly when it does. Both hold for
+// every n below 2^52, and there is no division in the inner loop.
+//
+// The kernel is picked at runtime from what the CPU supports:
+// AVX-512 (8 lanes), AVX2 + FMA (4 lanes), NEON (2 lanes), or a scalar
+// fallback. Each kernel keeps 16 candidates in flight to hide latency.
+
+constexpr int kTrialBatchSize = 16;
+
+// candidates at or above this are left to the scalar/Miller-Rabin path
+constexpr long long kSimdTrialLimit = 1LL << 52;
+
+// adding and subtracting 1.5 * 2^52 rounds a double below 2^51 to the nearest integer
+constexpr double kRoundMagic = 6755399441055744.0;
+
+enum class SimdLevel { Scalar, Neon, Avx2, Avx512 };
+
+inline const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx512: return "avx512";
+        case SimdLevel::Avx2: return "avx2";
+        case SimdLevel::Neon: return "neon";
+        default: return "scalar";
+    }
+}
+
+// best level this CPU can run
+inline SimdLevel detectSimdLevel() {
+#if defined(PRIME_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::Avx2;
+    return SimdLevel::Scalar;
+#elif defined(PRIME_SIMD_NEON)
+    return SimdLevel::Neon; // always there on AArch64
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+// tests count (<= kTrialBatchSize) candidates that are >= 5, odd, not divisible by 3
+// and below kSimdTrialLimit; sets is_prime[i] for each of them
+using TrialBatchKernel = void (*)(const long long* candidates, int count, bool* is_prime);
+
+inline void trialBatchScalar(const long long* candidates, int count, bool* is_prime) {
+    for (int i = 0; i < count; ++i) is_prime[i] = isPrimeTrialDivision(candidates[i]);
+}
+
+// lanes past count are padded with 1, which no divisor >= 5 can mark composite
+inline double loadTrialBatch(const long long* candidates, int count, double* lanes) {
+    double max_n = 0;
+    for (int i = 0; i < kTrialBatchSize; ++i) {
+        lanes[i] = (i < count) ? static_cast<double>(candidates[i]) : 1.0;
+        if (lanes[i] > max_n) max_n = lanes[i];
+    }
+    return max_n;
+}
+
+#if defined(PRIME_SIMD_X86)
+
+__attribute__((target("avx2,fma"))) inline void trialBatchAvx2(const long long* candidates, int count, bool* is_prime) {
+    constexpr int kVecs = kTrialBatchSize / 4;
+    alignas(32) double lanes[kTrialBatchSize];
+    double max_n = loadTrialBatch(candidates, count, lanes);
+
+    const __m256d magic = _mm256_set1_pd(kRoundMagic);
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d n[kVecs], composite[kVecs];
+    for (int v = 0; v < kVecs; ++v) {
+        n[v] = _mm256_load_pd(lanes + 4 * v);
+        composite[v] = zero;
+    }
+
+    for (long long d = 5, step = 0; d * d <= static_cast<long long>(max_n); d += 6, ++step) {
+        __m256d d1 = _mm256_set1_pd(static_cast<double>(d));
+        __m256d d2 = _mm256_set1_pd(static_cast<double>(d + 2));
+        __m256d inv1 = _mm256_set1_pd(1.0 / static_cast<double>(d));
+        __m256d inv2 = _mm256_set1_pd(1.0 / static_cast<double>(d + 2));
+        for (int v = 0; v < kVecs; ++v) {
+            __m256d q1 = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(n[v], inv1), magic), magic);
+            __m256d q2 = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(n[v], inv2), magic), magic);
+            __m256d r1 = _mm256_fnmadd_pd(q1, d1, n[v]);
+            __m256d r2 = _mm256_fnmadd_pd(q2, d2, n[v]);
+            // divisible, and not the candidate itself
+            __m256d hit1 = _mm256_and_pd(_mm256_cmp_pd(r1, zero, _CMP_EQ_OQ), _mm256_cmp_pd(d1, n[v], _CMP_LT_OQ));
+            __m256d hit2 = _mm256_and_pd(_mm256_cmp_pd(r2, zero, _CMP_EQ_OQ), _mm256_cmp_pd(d2, n[v], _CMP_LT_OQ));
+            composite[v] = _mm256_or_pd(composite[v], _mm256_or_pd(hit1, hit2));
+        }
+        // every so often, stop early if every lane is composite or past its square root
+        if ((step & 15) == 15) {
+            __m256d dd = _mm256_set1_pd(static_cast<double>(d + 6) * static_cast<double>(d + 6));
+            int done = 0;
+            for (int v = 0; v < kVecs; ++v) {
+                done += _mm256_movemask_pd(_mm256_or_pd(composite[v], _mm256_cmp_pd(dd, n[v], _CMP_GT_OQ))) == 0xF;
+            }
+            if (done == kVecs) break;
+        }
+    }
+
+    for (int v = 0; v < kVecs; ++v) {
+        int mask = _mm256_movemask_pd(composite[v]);
+        for (int k = 0; k < 4 && 4 * v + k < count; ++k) is_prime[4 * v + k] = !(mask & (1 << k));
+    }
+}
+
+__attribute__((target("avx512f"))) inline void trialBatchAvx512(const long long* candidates, int count, bool* is_prime) {
+    constexpr int kVecs = kTrialBatchSize / 8;
+    alignas(64) double lanes[kTrialBatchSize];
+    double max_n = loadTrialBatch(candidates, count, lanes);
+
+    const __m512d magic = _mm512_set1_pd(kRoundMagic);
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d n[kVecs];
+    __mmask8 composite[kVecs];
+    for (int v = 0; v < kVecs; ++v) {
+        n[v] = _mm512_load_pd(lanes + 8 * v);
+        composite[v] = 0;
+    }
+
+    for (long long d = 5, step = 0; d * d <= static_cast<long long>(max_n); d += 6, ++step) {
+        __m512d d1 = _mm512_set1_pd(static_cast<double>(d));
+        __m512d d2 = _mm512_set1_pd(static_cast<double>(d + 2));
+        __m512d inv1 = _mm512_set1_pd(1.0 / static_cast<double>(d));
+        __m512d inv2 = _mm512_set1_pd(1.0 / static_cast<double>(d + 2));
+        for (int v = 0; v < kVecs; ++v) {
+            __m512d q1 = _mm512_sub_pd(_mm512_add_pd(_mm512_mul_pd(n[v], inv1), magic), magic);
+            __m512d q2 = _mm512_sub_pd(_mm512_add_pd(_mm512_mul_pd(n[v], inv2), magic), magic);
+            __m512d r1 = _mm512_fnmadd_pd(q1, d1, n[v]);
+            __m512d r2 = _mm512_fnmadd_pd(q2, d2, n[v]);
+            __mmask8 hit1 = _mm512_cmp_pd_mask(r1, zero, _CMP_EQ_OQ) & _mm512_cmp_pd_mask(d1, n[v], _CMP_LT_OQ);
+            __mmask8 hit2 = _mm512_cmp_pd_mask(r2, zero, _CMP_EQ_OQ) & _mm512_cmp_pd_mask(d2, n[v], _CMP_LT_OQ);
+            composite[v] = static_cast<__mmask8>(composite[v] | hit1 | hit2);
+        }
+        if ((step & 15) == 15) {
+            __m512d dd = _mm512_set1_pd(static_cast<double>(d + 6) * static_cast<double>(d + 6));
+            int done = 0;
+            for (int v = 0; v < kVecs; ++v) {
+                done += static_cast<__mmask8>(composite[v] | _mm512_cmp_pd_mask(dd, n[v], _CMP_GT_OQ)) == 0xFF;
+            }
+            if (done == kVecs) break;
+        }
+    }
+
+    for (int v = 0; v < kVecs; ++v) {
+        for (int k = 0; k < 8 && 8 * v + k < count; ++k) is_prime[8 * v + k] = !(composite[v] & (1 << k));
+    }
+}
+
+#endif // PRIME_SIMD_X86
+
+#if defined(PRIME_SIMD_NEON)
+
+inline void trialBatchNeon(const long long* candidates, int count, bool* is_prime) {
+    constexpr int kVecs = kTrialBatchSize / 2;
+    alignas(16) double lanes[kTrialBatchSize];
+    double max_n = loadTrialBatch(candidates, count, lanes);
+
+    float64x2_t n[kVecs];
+    uint64x2_t composite[kVecs];
+    for (int v = 0; v < kVecs; ++v) {
+        n[v] = vld1q_f64(lanes + 2 * v);
+        composite[v] = vdupq_n_u64(0);
+    }
+
+    for (long long d = 5, step = 0; d * d <= static_cast<long long>(max_n); d += 6, ++step) {
+        float64x2_t d1 = vdupq_n_f64(static_cast<double>(d));
+        float64x2_t d2 = vdupq_n_f64(static_cast<double>(d + 2));
+        float64x2_t inv1 = vdupq_n_f64(1.0 / static_cast<double>(d));
+        float64x2_t inv2 = vdupq_n_f64(1.0 / static_cast<double>(d + 2));
+        for (int v = 0; v < kVecs; ++v) {
+            float64x2_t q1 = vrndnq_f64(vmulq_f64(n[v], inv1));
+            float64x2_t q2 = vrndnq_f64(vmulq_f64(n[v], inv2));
+            float64x2_t r1 = vfmsq_f64(n[v], q1, d1); // n - q1 * d1, fused
+            float64x2_t r2 = vfmsq_f64(n[v], q2, d2);
+            uint64x2_t hit1 = vandq_u64(vceqzq_f64(r1), vcltq_f64(d1, n[v]));
+            uint64x2_t hit2 = vandq_u64(vceqzq_f64(r2), vcltq_f64(d2, n[v]));
+            composite[v] = vorrq_u64(composite[v], vorrq_u64(hit1, hit2));
+        }
+        if ((step & 15) == 15) {
+            float64x2_t dd = vdupq_n_f64(static_cast<double>(d + 6) * static_cast<double>(d + 6));
+            bool all_done = true;
+            for (int v = 0; v < kVecs && all_done; ++v) {
+                uint64x2_t done = vorrq_u64(composite[v], vcgtq_f64(dd, n[v]));
+                all_done = vgetq_lane_u64(done, 0) && vgetq_lane_u64(done, 1);
+            }
+            if (all_done) break;
+        }
+    }
+
+    for (int v = 0; v < kVecs; ++v) {
+        if (2 * v < count) is_prime[2 * v] = vgetq_lane_u64(composite[v], 0) == 0;
+        if (2 * v + 1 < count) is_prime[2 * v + 1] = vgetq_lane_u64(composite[v], 1) == 0;
+    }
+}
+
+#endif // PRIME_SIMD_NEON
+
+inline TrialBatchKernel trialBatchKernel(SimdLevel level) {
+    switch (level) {
+#if defined(PRIME_SIMD_X86)
+        case SimdLevel::Avx512: return trialBatchAvx512;
+        case SimdLevel::Avx2: return trialBatchAvx2;
+#endif
+#if defined(PRIME_SIMD_NEON)
+        case SimdLevel::Neon: return trialBatchNeon;
+#endif
+        default: return trialBatchScalar;
+    }
+}
+
+// picks the kernel for a SIMD setting: "auto" (best the CPU has), "scalar", "avx2",
+// "avx512" or "neon". Asking for a level the CPU can't run falls back to the best one.
+// returns false for "off" (keep the one-number-at-a-time loop).
+inline bool pickSimdLevel(const std::string& name, SimdLevel& level) {
+    if (name == "off") return false;
+    SimdLevel best = detectSimdLevel();
+    level = best;
+    if (name == "auto") return true;
+
+    SimdLevel wanted;
+    if (name == "scalar") wanted = SimdLevel::Scalar;
+    else if (name == "avx2") wanted = SimdLevel::Avx2;
+    else if (name == "avx512") wanted = SimdLevel::Avx512;
+    else if (name == "neon") wanted = SimdLevel::Neon;
+    else {
+        std::cerr << "Unknown SIMD '" << name << "', using " << simdLevelName(best) << "." << std::endl;
+        return true;
+    }
+
+    bool supported = wanted == SimdLevel::Scalar || wanted == best
+                  || (wanted == SimdLevel::Avx2 && best == SimdLevel::Avx512);
+    if (!supported) {
+        std::cerr << "SIMD '" << name << "' not supported on this CPU, using " << simdLevelName(best) << "." << std::endl;
+        return true;
+    }
+    level = wanted;
+    return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Thread pool that stays alive between jobs, so back-to-back searches don't
+// pay for creating and joining THREAD_COUNT threads every time.
+//   submit(fn)    - queues fn, returns a std::future for its result
+//   reserve(n)    - makes sure at least n threads exist (the pool only grows)
+//   shared()      - the process-wide pool used by THREAD_POOL=on
+// Jobs run in the order they were submitted. The destructor lets every
+// queued job finish before joining the threads.
+// Only uses the standard library, so other programs can include it as is.
+class ThreadPool {
+public:
+    explicit ThreadPool(std::size_t threads = 0) { reserve(threads); }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread& t : threads_) t.join();
+    }
+
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    void reserve(std::size_t threads) {
+        std::lock_guard<std::mutex> lock(m_);
+        while (threads_.size() < threads) {
+            threads_.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(m_);
+        return threads_.size();
+    }
+
+    template <typename Fn>
+    std::future<std::invoke_result_t<std::decay_t<Fn>>> submit(Fn&& fn) {
+        using Result = std::invoke_result_t<std::decay_t<Fn>>;
+        // packaged_task is move-only and std::function wants a copy, so share it
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            jobs_.emplace_back([task] { (*task)(); });
+        }
+        cv_.notify_one();
+        return result;
+    }
+
+private:
+    void workerLoop() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_);
+                cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+                if (jobs_.empty()) return; // stopping and nothing left to run
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    mutable std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+};
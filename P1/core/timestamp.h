@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Timestamp and thread-id formatting shared by all the variants.
+// These are called once per prime, so the hot-path versions write into a
+// caller-provided buffer and never allocate:
+// - the "HH:MM:SS" part only changes once a second, so each thread keeps
+//   it cached and only calls localtime again when the second rolls over
+// - each thread's id string is built once and kept in thread-local storage
+
+// "HH:MM:SS.mmm" plus the terminating null
+constexpr std::size_t kTimestampBufferSize = 13;
+
+// writes the current local time as "HH:MM:SS.mmm" into out, returns the length (12)
+inline std::size_t formatTimestamp(char* out) {
+    thread_local std::time_t cached_second = static_cast<std::time_t>(-1);
+    thread_local char cached_hms[9] = {0};
+
+    auto now = std::chrono::system_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+    std::time_t t_c = std::chrono::system_clock::to_time_t(now);
+
+    if (t_c != cached_second) {
+        // new second - redo the expensive local time conversion
+        std::tm tm_buf;
+        #ifdef _WIN32
+            localtime_s(&tm_buf, &t_c);
+        #else
+            localtime_r(&t_c, &tm_buf);
+        #endif
+        std::strftime(cached_hms, sizeof(cached_hms), "%H:%M:%S", &tm_buf);
+        cached_second = t_c;
+    }
+
+    std::memcpy(out, cached_hms, 8);
+    out[8] = '.';
+    out[9] = static_cast<char>('0' + ms / 100);
+    out[10] = static_cast<char>('0' + (ms / 10) % 10);
+    out[11] = static_cast<char>('0' + ms % 10);
+    out[12] = '\0';
+    return 12;
+}
+
+// gets current time in a nice format (allocates, so keep it off the hot path)
+inline std::string getCurrentTimestamp() {
+    char buf[kTimestampBufferSize];
+    formatTimestamp(buf);
+    return std::string(buf);
+}
+
+// gets the thread ID as a string (for printing), built once per thread
+inline const std::string& getThreadId() {
+    thread_local const std::string id = [] {
+        std::stringstream ss;
+        ss << std::this_thread::get_id();
+        return ss.str();
+    }();
+    return id;
+}
+
+// writes "[Time: HH:MM:SS.mmm] [Thread: <id>] " into out, returns the length.
+// out needs room for about 40 bytes plus the thread id.
+inline std::size_t formatLogPrefix(char* out) {
+    std::size_t len = 0;
+    std::memcpy(out, "[Time: ", 7);
+    len += 7;
+    len += formatTimestamp(out + len);
+    std::memcpy(out + len, "] [Thread: ", 11);
+    len += 11;
+    const std::string& id = getThreadId();
+    std::memcpy(out + len, id.data(), id.size());
+    len += id.size();
+    std::memcpy(out + len, "] ", 2);
+    len += 2;
+    return len;
+}
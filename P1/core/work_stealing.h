@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Chunked work-stealing scheduler for the Number Division variants.
+// The producer hands out contiguous chunks of numbers round-robin into
+// per-worker deques. A worker pops chunks from the front of its own deque
+// and, when that runs dry, steals from the back of someone else's, so the
+// only lock taken per chunk is one small per-deque mutex.
+
+// a contiguous block of numbers [start, end] (inclusive)
+struct NumberChunk {
+    long long start;
+    long long end;
+};
+
+class WorkStealingScheduler {
+public:
+    explicit WorkStealingScheduler(int worker_count) {
+        if (worker_count < 1) worker_count = 1;
+        for (int i = 0; i < worker_count; ++i) {
+            deques_.push_back(std::make_unique<WorkerDeque>());
+        }
+    }
+
+    int workerCount() const { return static_cast<int>(deques_.size()); }
+
+    // producer side: give a chunk to the given worker's deque
+    void push(int worker, NumberChunk chunk) {
+        {
+            WorkerDeque& d = *deques_[worker % deques_.size()];
+            std::lock_guard<std::mutex> lock(d.m);
+            d.chunks.push_back(chunk);
+        }
+        pending_.fetch_add(1);
+        // only wake someone if a worker is actually sleeping
+        if (sleepers_.load() > 0) {
+            std::lock_guard<std::mutex> lock(idle_m_);
+            idle_cv_.notify_one();
+        }
+    }
+
+    // splits [first, last] into chunks of chunk_size and deals them out round-robin.
+    // returns the number of chunks pushed
+    long long pushRange(long long first, long long last, long long chunk_size) {
+        if (chunk_size < 1) chunk_size = 1;
+        int worker = 0;
+        long long chunks = 0;
+        for (long long lo = first; lo <= last;) {
+            long long hi = (last - lo >= chunk_size) ? lo + chunk_size - 1 : last;
+            push(worker, {lo, hi});
+            ++chunks;
+            worker = (worker + 1) % workerCount();
+            if (hi == last) break;
+            lo = hi + 1;
+        }
+        return chunks;
+    }
+
+    // producer side: no more chunks will be pushed
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(idle_m_);
+            done_.store(true);
+        }
+        idle_cv_.notify_all();
+    }
+
+    // worker side: gets the next chunk for this worker (own deque first, then steal).
+    // returns false once the producer is done and every deque is empty.
+    bool next(int worker, NumberChunk& out) {
+        while (true) {
+            if (popOwn(worker, out) || steal(worker, out)) {
+                pending_.fetch_sub(1);
+                return true;
+            }
+
+            // nothing to do right now - sleep until the producer adds more or finishes
+            std::unique_lock<std::mutex> lock(idle_m_);
+            sleepers_.fetch_add(1);
+            idle_cv_.wait(lock, [&] {
+                return pending_.load() > 0 || done_.load();
+            });
+            sleepers_.fetch_sub(1);
+            if (pending_.load() == 0 && done_.load()) {
+                return false;
+            }
+        }
+    }
+
+private:
+    // padded so neighbouring deques don't share a cache line
+    struct alignas(64) WorkerDeque {
+        std::mutex m;
+        std::deque<NumberChunk> chunks;
+    };
+
+    bool popOwn(int worker, NumberChunk& out) {
+        WorkerDeque& d = *deques_[worker];
+        std::lock_guard<std::mutex> lock(d.m);
+        if (d.chunks.empty()) return false;
+        out = d.chunks.front();
+        d.chunks.pop_front();
+        return true;
+    }
+
+    bool steal(int thief, NumberChunk& out) {
+        const int n = workerCount();
+        for (int k = 1; k < n; ++k) {
+            WorkerDeque& victim = *deques_[(thief + k) % n];
+            std::lock_guard<std::mutex> lock(victim.m);
+            if (victim.chunks.empty()) continue;
+            out = victim.chunks.back();
+            victim.chunks.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<std::unique_ptr<WorkerDeque>> deques_;
+    std::atomic<long long> pending_{0}; // chunks pushed but not yet taken
+    std::atomic<int> sleepers_{0};
+    std::atomic<bool> done_{false};
+    std::mutex idle_m_;
+    std::condition_variable idle_cv_;
+};
@@ -0,0 +1,57 @@
+// Answers questions about a binary result file (RESULT_FILE in a config)
+// straight from the memory-mapped file, without running the search again.
+//
+// Usage: prime_query <file> info
+//        prime_query <file> nth <n>
+//        prime_query <file> count <a> <b>
+//        prime_query <file> range <a> <b>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "core/prime_file.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <file> info | nth <n> | count <a> <b> | range <a> <b>" << std::endl;
+        return 1;
+    }
+
+    PrimeFileReader reader;
+    std::string error;
+    if (!reader.open(argv[1], error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+
+    std::string command = argv[2];
+    if (command == "info") {
+        std::cout << "Range: [" << reader.first() << ", " << reader.last() << "]" << std::endl;
+        std::cout << "Primes: " << reader.totalPrimes() << std::endl;
+        std::cout << "Segments: " << reader.segmentCount() << std::endl;
+        return 0;
+    }
+    if (command == "nth" && argc >= 4) {
+        long long prime = 0;
+        if (!reader.nthPrime(std::strtoull(argv[3], nullptr, 10), prime)) {
+            std::cerr << "The file only has " << reader.totalPrimes() << " primes." << std::endl;
+            return 1;
+        }
+        std::cout << prime << std::endl;
+        return 0;
+    }
+    if ((command == "count" || command == "range") && argc >= 5) {
+        long long a = std::atoll(argv[3]);
+        long long b = std::atoll(argv[4]);
+        if (command == "count") {
+            std::cout << reader.countInRange(a, b) << std::endl;
+        } else {
+            reader.forEachInRange(a, b, [](long long prime) { std::cout << prime << " "; });
+            std::cout << std::endl;
+        }
+        return 0;
+    }
+
+    std::cerr << "Unknown or incomplete command '" << command << "'." << std::endl;
+    return 1;
+}
@@ -0,0 +1,33 @@
+// Single driver for all four variants, so they can be benchmarked side by side
+// from one binary. Each case is its own template instantiation (no virtual calls).
+//
+// Usage: prime_search <variant 1-4> [config file] [--KEY=value ...]
+// (the config file defaults to varN/configN.ini, so run it from the P1 folder;
+// the flags and P1_<KEY> environment variables override it, see core/config.h)
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "core/prime_search.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <variant 1-4> [config file] [--KEY=value ...]" << std::endl;
+        return 1;
+    }
+
+    int variant = std::atoi(argv[1]);
+    std::string config_path = "var" + std::to_string(variant) + "/config" + std::to_string(variant) + ".ini";
+    int args = argc - 2;
+    char** arg = argv + 2;
+
+    switch (variant) {
+        case 1: return runPrimeSearch<RangeDivision, ImmediatePrint>(1, config_path, args, arg);
+        case 2: return runPrimeSearch<RangeDivision, BatchedPrint>(2, config_path, args, arg);
+        case 3: return runPrimeSearch<NumberDivision, ImmediatePrint>(3, config_path, args, arg);
+        case 4: return runPrimeSearch<NumberDivision, BatchedPrint>(4, config_path, args, arg);
+        default:
+            std::cerr << "Unknown variant '" << argv[1] << "' (expected 1-4)." << std::endl;
+            return 1;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Pins the calling thread to cpus [first, first + count). Used to keep each
+// matchmaking shard (its matchmaker, instance workers and producers) on its
+// own cores. Returns false if the platform has no affinity call or the
+// cpus don't exist; the thread then just runs wherever the OS puts it.
+inline bool pin_current_thread(int first, int count) {
+    if (first < 0 || count < 1) return false;
+#if defined(_WIN32)
+    if (first + count > 64) return false;
+    DWORD_PTR mask = 0;
+    for (int cpu = first; cpu < first + count; ++cpu) mask |= DWORD_PTR(1) << cpu;
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    if (first + count > CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = first; cpu < first + count; ++cpu) CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+// The cpus shard s of shards gets: an even share of the hardware threads,
+// or (with more shards than cpus) one cpu round robin.
+inline void shard_cpus(int s, int shards, int& first, int& count) {
+    int cpus = static_cast<int>(std::thread::hardware_concurrency());
+    if (cpus < 1) cpus = 1;
+    if (shards >= cpus) {
+        first = s % cpus;
+        count = 1;
+        return;
+    }
+    first = s * cpus / shards;
+    count = (s + 1) * cpus / shards - first;
+}
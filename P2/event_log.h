@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "mpsc_ring.h"
+
+// One thing that happened in the queue. 32 bytes, little-endian; this is
+// also the record layout of --events=binary.
+struct QueueEvent {
+    enum Type : std::uint32_t { kArrival = 1, kEnter = 2, kFinish = 3, kTurnedAway = 4, kStatus = 5, kMigrate = 6 };
+
+    // field use by type (kMigrate: the balancer moved b players of role a
+    // from shard party to shard instance)
+    std::uint64_t time_ns = 0;             // since the start (virtual under --sim)
+    std::uint32_t type = 0;
+    std::int32_t party = 0;                // kEnter, kFinish; kStatus: shard; kMigrate: from
+    std::int32_t instance = 0;             // kEnter, kFinish; kStatus: shard's active instances; kMigrate: to
+    std::int32_t a = 0;                    // kArrival, kStatus: tanks; kEnter: run s; kTurnedAway: players; kMigrate: role
+    std::int32_t b = 0;                    // kArrival, kStatus: healers; kMigrate: players
+    std::int32_t c = 0;                    // kArrival, kStatus: DPS
+};
+static_assert(sizeof(QueueEvent) == 32, "QueueEvent is a fixed 32-byte record");
+
+// Instance workers, arrival producers and the matchmaker emit() events
+// here without ever blocking; the reporter drains them. If the reporter
+// falls behind and the ring fills up, events are dropped (and counted)
+// instead of making a dungeon thread wait.
+class EventLog {
+public:
+    explicit EventLog(std::size_t capacity) : ring(capacity) {}
+
+    void emit(const QueueEvent& event) {
+        if (!ring.try_push(event)) dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+
+    // --- reporter only ---
+
+    // hands every event written so far to fn, oldest first; returns how many
+    template <typename Fn>
+    std::size_t drain(Fn&& fn) {
+        std::size_t count = 0;
+        while (ring.front_ready(1)) {
+            fn(ring.pop());
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    MpscRing<QueueEvent> ring;
+    std::atomic<std::uint64_t> dropped{0};
+};
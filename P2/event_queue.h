@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Time-ordered event queue for the virtual-clock simulation (--sim).
+// pop() hands out the earliest event; events at the same time come out in
+// the order they were pushed, so a run is reproducible for a given seed.
+template <typename Event>
+class EventQueue {
+public:
+    void push(double time, Event event) { heap.push({time, next_seq++, std::move(event)}); }
+
+    bool empty() const { return heap.empty(); }
+    std::size_t size() const { return heap.size(); }
+
+    // removes the earliest event and returns it, its time goes to time
+    Event pop(double& time) {
+        Entry top = heap.top();
+        heap.pop();
+        time = top.time;
+        return top.event;
+    }
+
+private:
+    struct Entry {
+        double time;
+        std::uint64_t seq;
+        Event event;
+    };
+    struct Later {
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.time != b.time ? a.time > b.time : a.seq > b.seq;
+        }
+    };
+
+    std::priority_queue<Entry, std::vector<Entry>, Later> heap;
+    std::uint64_t next_seq = 0;
+};
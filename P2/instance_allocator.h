@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+
+// Free-instance allocator: one bit per instance (1 = empty), 64 per word.
+// The policy scans the empty instances with for_each_free() and picks one;
+// try_acquire(id) then claims it with one fetch_and (false if it is
+// already active; this replaces the counting semaphore + string scan).
+// Everything is lock-free; whoever needs to wait for a release (the
+// matchmaker) waits on its own condition variable.
+class InstanceAllocator {
+public:
+    explicit InstanceAllocator(int n)
+        : count(n), word_count((n + 63) / 64), words(new std::atomic<std::uint64_t>[word_count]) {
+        for (int w = 0; w < word_count; ++w) {
+            int bits = std::min(64, n - w * 64);
+            words[w].store(bits == 64 ? ~0ull : ((1ull << bits) - 1));
+        }
+    }
+
+    int size() const { return count; }
+
+    // claims instance id if it is empty
+    bool try_acquire(int id) {
+        std::uint64_t bit = 1ull << (id % 64);
+        return (words[id / 64].fetch_and(~bit, std::memory_order_acquire) & bit) != 0;
+    }
+
+    void release(int id) {
+        words[id / 64].fetch_or(1ull << (id % 64), std::memory_order_release);
+    }
+
+    int free_count() const {
+        int total = 0;
+        for (int w = 0; w < word_count; ++w) total += std::popcount(words[w].load(std::memory_order_relaxed));
+        return total;
+    }
+
+    // calls fn(id) for every empty instance, lowest first (acquire: whatever
+    // the last holder wrote before release() is visible to fn)
+    template <typename Fn>
+    void for_each_free(Fn&& fn) const {
+        for (int w = 0; w < word_count; ++w) {
+            std::uint64_t bits = words[w].load(std::memory_order_acquire);
+            while (bits != 0) {
+                fn(w * 64 + std::countr_zero(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    bool is_active(int id) const {
+        return (words[id / 64].load(std::memory_order_relaxed) & (1ull << (id % 64))) == 0;
+    }
+
+private:
+    int count;
+    int word_count;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> words;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cmath>
+#include <random>
+#include <string>
+
+// Who joins the queue, and when (--load=SHAPE). Every arrival producer
+// runs its own ArrivalStream, with rate split evenly between them.
+//   classic  - the original arrival thread: 10 rounds, every 1-3 s up to
+//              2 tanks, 2 healers and 6 DPS (per producer, rate/mix unused)
+//   poisson  - single players at a steady average rate
+//   bursty   - the same average rate, all of it packed into the first
+//              burst_fraction of every burst_period seconds
+//   diurnal  - the rate follows a day curve of day_length seconds, from
+//              (1 - swing) x rate at midnight up to (1 + swing) x rate at noon
+// rate is players/s over all producers, mix the tank : healer : DPS weights.
+struct LoadProfile {
+    enum class Shape { Classic, Poisson, Bursty, Diurnal };
+
+    static constexpr double kDiurnalSwing = 0.8;
+
+    Shape shape = Shape::Classic;
+    int producers = 1;
+    double rate = 100;                     // players per second
+    double duration = 30;                  // seconds of arrivals (not classic)
+    double mix[3] = {1, 1, 3};             // tanks : healers : dps
+    double burst_period = 10;              // seconds
+    double burst_fraction = 0.2;
+    double day_length = 60;                // seconds
+
+    // players per second (all producers) at time t
+    double rate_at(double t) const {
+        switch (shape) {
+        case Shape::Bursty:
+            return std::fmod(t, burst_period) < burst_fraction * burst_period ? rate / burst_fraction : 0;
+        case Shape::Diurnal:
+            return rate * (1 - kDiurnalSwing * std::cos(2 * 3.14159265358979323846 * t / day_length));
+        default:
+            return rate;
+        }
+    }
+
+    double peak_rate() const {
+        switch (shape) {
+        case Shape::Bursty: return rate / burst_fraction;
+        case Shape::Diurnal: return rate * (1 + kDiurnalSwing);
+        default: return rate;
+        }
+    }
+};
+
+inline const char* shape_name(LoadProfile::Shape shape) {
+    switch (shape) {
+    case LoadProfile::Shape::Poisson: return "poisson";
+    case LoadProfile::Shape::Bursty: return "bursty";
+    case LoadProfile::Shape::Diurnal: return "diurnal";
+    default: return "classic";
+    }
+}
+
+// false for an unknown name
+inline bool parse_shape(const std::string& name, LoadProfile::Shape& shape) {
+    for (LoadProfile::Shape s : {LoadProfile::Shape::Classic, LoadProfile::Shape::Poisson, LoadProfile::Shape::Bursty,
+                                 LoadProfile::Shape::Diurnal}) {
+        if (name == shape_name(s)) {
+            shape = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Players joining together, at_s seconds after the start
+struct ArrivalBatch {
+    double at_s = 0;
+    int tanks = 0;
+    int healers = 0;
+    int dps = 0;
+};
+
+// One producer's arrivals, in time order. The poisson, bursty and diurnal
+// shapes are a Poisson process with rate rate_at(t) / producers, drawn by
+// thinning: candidates come at the peak rate and each is kept with
+// probability rate_at(t) / peak.
+// A classic stream can be dealt out over shares streams (--shards): each
+// draws the same rounds and keeps every shares-th one, starting at share,
+// so together they queue exactly the players one stream would.
+class ArrivalStream {
+public:
+    ArrivalStream(const LoadProfile& profile, unsigned seed, int share = 0, int shares = 1)
+        : profile(profile), gen(seed), gap(profile.peak_rate() > 0 ? profile.peak_rate() / profile.producers : 1.0),
+          role(profile.mix, profile.mix + 3), share(share), shares(shares < 1 ? 1 : shares) {}
+
+    // the next batch; false once this producer is done
+    bool next(ArrivalBatch& batch) {
+        batch = ArrivalBatch{};
+        if (profile.shape == LoadProfile::Shape::Classic) {
+            while (rounds_left > 0) {
+                --rounds_left;
+                now_s += std::uniform_int_distribution<>(1, 3)(gen);
+                batch.at_s = now_s;
+                batch.tanks = std::uniform_int_distribution<>(0, 2)(gen);
+                batch.healers = std::uniform_int_distribution<>(0, 2)(gen);
+                batch.dps = std::uniform_int_distribution<>(0, 6)(gen);
+                if (round++ % shares == share) return true;
+            }
+            return false;
+        }
+        if (!(profile.peak_rate() > 0)) return false;
+        const double peak = profile.peak_rate();
+        while (true) {
+            now_s += gap(gen);
+            if (now_s >= profile.duration) return false;
+            if (keep(gen) * peak <= profile.rate_at(now_s)) break;
+        }
+        batch.at_s = now_s;
+        switch (role(gen)) {
+        case 0: batch.tanks = 1; break;
+        case 1: batch.healers = 1; break;
+        default: batch.dps = 1; break;
+        }
+        return true;
+    }
+
+private:
+    LoadProfile profile;
+    std::mt19937_64 gen;
+    std::exponential_distribution<> gap;
+    std::uniform_real_distribution<> keep{0.0, 1.0};
+    std::discrete_distribution<> role;
+    double now_s = 0;
+    int rounds_left = 10;
+    int share;                             // classic: which of every shares rounds are ours
+    int shares;
+    int round = 0;
+};
@@ -8,172 +8,871 @@
 #include <random>         // For dungeon time simulation
 #include <algorithm>      // For std::min
 #include <iomanip>        // For std::setw (output formatting)
+#include <deque>          // For match timestamps
+#include <atomic>         // For the arrival-done flag
+#include <memory>         // For the scheduling policy
+#include <fstream>        // For --events-file
+
+#include "affinity.h"     // Pinning shards to cpus
+#include "event_log.h"    // Lock-free event ring
+#include "event_queue.h"  // Virtual-clock simulation
+#include "instance_allocator.h" // Free-instance bitmap
+#include "load_generator.h" // Arrival producers
+#include "options.h"      // Command-line / config settings
+#include "player_queue.h" // Lock-free role queues
+#include "policy.h"       // Scheduling policies
+#include "status_reporter.h" // Event output and status snapshots
+#include "wait_histogram.h" // Per-role player waits
+#include "worker_pool.h"  // Instance workers
 
 // Globals
-int g_max_instances;                       // max concurrent instances
-
-// Simple counting semaphore (portable)
-class CountingSemaphore {
-public:
-    explicit CountingSemaphore(int initial = 0) : count(initial) {}
-    void acquire() {
-        std::unique_lock<std::mutex> lock(m);
-        cv.wait(lock, [&]() { return count > 0; });
-        --count;
-    }
-    void release() {
-        std::lock_guard<std::mutex> lock(m);
-        ++count;
-        cv.notify_one();
-    }
-private:
-    std::mutex m;
-    std::condition_variable cv;
-    int count;
+using Clock = std::chrono::steady_clock;
+int g_max_instances;                       // max concurrent instances, over all shards
+EventLog* g_events = nullptr;              // where events go (nullptr with --quiet); the reporter prints them
+std::unique_ptr<SchedulingPolicy> g_policy; // --policy, fifo by default (stateless, shared by the shards)
+Clock::time_point g_start_time;
+bool g_log_events = true;                  // --quiet turns the events off
+
+// Per-instance stats, one cache line each. Only the worker running a party
+// in that instance writes its slot (the claim bit makes that exclusive); the
+// matchmaker reads the slots of empty instances only, and main reads them
+// after the workers are joined, so no lock is needed.
+struct alignas(64) InstanceStats {
+    int parties_served = 0;
+    double time_served = 0;                // seconds
 };
 
-CountingSemaphore* g_instance_slots; // controls available slots
-std::mutex g_data_mutex;                   // protects the data vectors
-std::vector<std::string> g_instance_status; // "empty" or "active"
-std::vector<int> g_parties_served;         // count per instance
-std::vector<double> g_time_served;         // seconds per instance
-std::mutex g_cout_mutex;                   // protect std::cout
+// Dungeon run times, uniform in [min_time, max_time] seconds.
+// Only the shard's matchmaker draws from it.
+struct RunTimes {
+    std::mt19937 gen;
+    std::uniform_int_distribution<> dis;
 
-// Player pool (shared)
-int g_tanks = 0;
-int g_healers = 0;
-int g_dps = 0;
-bool g_arrival_done = false;
+    RunTimes(unsigned seed, int min_time, int max_time) : gen(seed), dis(min_time, max_time) {}
+    int next() { return dis(gen); }
+};
+
+// What each arrival producer queued (only that producer writes its slot)
+struct alignas(64) ProducerStats {
+    long long arrived = 0;
+    long long turned_away = 0;
+};
+
+// One matchmaking shard (--shards=K; think one region or server): its own
+// instances, player queues, matchmaker, instance workers and arrival
+// producers, so shards never wait on each other. Only the balancer touches
+// two shards, moving players from one's queues to the other's.
+// The ready parties, latency vector and waits are under match_mutex
+// (arrivals and finished runs take it only to signal match_cv).
+struct Shard {
+    int index = 0;
+    int first_instance = 0;                // global number of its instance 0 (events, summary)
+    int first_cpu = 0;
+    int cpu_count = 0;                     // 0: not pinned
+
+    std::unique_ptr<InstanceAllocator> instances; // which instances are empty (claim = one CAS)
+    std::vector<InstanceStats> instance_stats;
+    std::unique_ptr<PlayerQueues> players; // one lock-free FIFO per role (arrivals push, the matchmaker takes)
+    std::atomic<bool> arrival_done{false}; // no more players will come (arrivals and balancing are over)
+    WaitHistogram player_waits[PlayerQueues::kRoleCount]; // queue join -> party formed
+
+    std::mutex match_mutex;
+    std::condition_variable match_cv;      // signaled on arrivals, migrations and instance releases
+    ReadyParties ready;                    // each currently formable party, when it became formable
+    std::vector<double> match_latency_ms;  // ready -> entered an instance, per party
+    RunTimes run_times{0, 0, 0};
+    int parties_formed = 0;
+
+    std::vector<ProducerStats> producer_stats;
+    long long migrated_in = 0;             // balancer only
+    long long migrated_out = 0;
+};
+std::vector<std::unique_ptr<Shard>> g_shards;
+std::atomic<int> g_producers_left{0};      // over all shards
 
 // Helper Functions
 
-// Print current status of instances.
-// Call while holding g_cout_mutex.
-void print_status() {
-    std::cout << "Instance Status: |";
-    std::lock_guard<std::mutex> data_lock(g_data_mutex);
-    for (int i = 0; i < g_max_instances; ++i) {
-        std::string status = g_instance_status[i];
-        if (status == "empty") {
-            std::cout << " " << std::setw(8) << "empty" << " |";
-        } else {
-            std::cout << " " << std::setw(8) << status << " |";
-        }
-    }
-    std::cout << "\n--------------------------------------------------------\n";
+// Log one event at time now (no-op with --quiet). Never blocks.
+void log_event(QueueEvent::Type type, Clock::time_point now, int party, int instance, int a, int b = 0, int c = 0) {
+    if (!g_events) return;
+    QueueEvent e;
+    e.time_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - g_start_time).count());
+    e.type = type;
+    e.party = party;
+    e.instance = instance;
+    e.a = a;
+    e.b = b;
+    e.c = c;
+    g_events->emit(e);
 }
 
-// Each party runs this function.
-// Steps: wait for a slot, claim an instance, run, update stats, release.
-void run_dungeon(int party_id, int min_time, int max_time) {
-    // RNG for this thread
-    std::random_device rd;
-    std::mt19937 generator(rd() + party_id);
-    std::uniform_int_distribution<> dis(min_time, max_time);
-    int duration = dis(generator);
+// Wake a shard's matchmaker after queueing players or freeing an instance
+// (lock so the wake-up can't slip in between its check and its wait)
+void wake_matchmaker(Shard& shard) {
+    { std::lock_guard<std::mutex> lock(shard.match_mutex); }
+    shard.match_cv.notify_one();
+}
 
-    // wait for an available slot
-    g_instance_slots->acquire();
+// Keep the calling thread on the shard's cpus (if it has any)
+void pin_to_shard(const Shard& shard) {
+    if (shard.cpu_count > 0) pin_current_thread(shard.first_cpu, shard.cpu_count);
+}
 
-    // find and mark a free instance
+// One formed party and the instance claimed for it (the shard's own
+// numbering), waiting for an instance worker
+struct PartyJob {
+    int party_id = 0;
     int instance_id = -1;
+    int duration = 0;                      // seconds
+};
+
+// Log the party entering its instance (the run itself is up to the caller).
+void start_party(Shard& shard, const PartyJob& job, Clock::time_point now) {
+    log_event(QueueEvent::kEnter, now, job.party_id, shard.first_instance + job.instance_id, job.duration);
+}
+
+// Update the instance's stats, free it and log the finish.
+void finish_party(Shard& shard, const PartyJob& job, Clock::time_point now) {
+    // this instance's slot is ours until the release
+    shard.instance_stats[job.instance_id].parties_served++;
+    shard.instance_stats[job.instance_id].time_served += job.duration;
+    shard.instances->release(job.instance_id);
+    log_event(QueueEvent::kFinish, now, job.party_id, shard.first_instance + job.instance_id, 0);
+}
+
+// Each party runs this function (on one of the shard's instance workers).
+// Steps: run in the instance the matchmaker claimed, update stats, release.
+void run_dungeon(Shard& shard, const PartyJob& job) {
+    start_party(shard, job, Clock::now());
+
+    // simulate run
+    std::this_thread::sleep_for(std::chrono::seconds(job.duration));
+
+    finish_party(shard, job, Clock::now());
+
+    // the matchmaker may have a party waiting for this instance
+    wake_matchmaker(shard);
+}
+
+// True if the shard's pool holds at least 1 tank, 1 healer and 3 DPS.
+bool party_available(const Shard& shard) {
+    PlayerQueues::Counts c = shard.players->counts();
+    return c.tanks >= 1 && c.healers >= 1 && c.dps >= 3;
+}
+
+// Stamp (and draw the run time of) every party the pool can now form that
+// it couldn't before. The matchmaker calls this (holding match_mutex)
+// whenever it wakes up, so arrivals only have to queue their players.
+void record_ready_parties(Shard& shard, Clock::time_point now) {
+    PlayerQueues::Counts c = shard.players->counts();
+    std::size_t possible = static_cast<std::size_t>(std::min({c.tanks, c.healers, c.dps / 3}));
+    while (shard.ready.size() < possible) shard.ready.push({now, shard.run_times.next()});
+}
+
+// Take the longest-waiting tank, healer and 3 DPS for the ready party in
+// the given bucket (its instance is already claimed) and record how long each
+// player waited. Call while holding match_mutex.
+// Returns false if one of them was still being queued.
+bool form_party(Shard& shard, Clock::time_point now, int bucket, PendingParty& party) {
+    Player players[5];
+    if (!shard.players->try_take_party(players)) return false;
+    static const PlayerQueues::Role kSeatRoles[5] = {PlayerQueues::kTank, PlayerQueues::kHealer, PlayerQueues::kDps,
+                                                     PlayerQueues::kDps, PlayerQueues::kDps};
+    for (int i = 0; i < 5; ++i) {
+        shard.player_waits[kSeatRoles[i]].add(std::chrono::duration<double, std::milli>(now - players[i].arrived).count());
+    }
+    party = shard.ready.take(bucket);
+    shard.match_latency_ms.push_back(std::chrono::duration<double, std::milli>(now - party.ready_at).count());
+    return true;
+}
+
+// Does the policy want to start parties in this shard right now?
+// Call while holding match_mutex.
+int parties_to_form(Shard& shard) {
+    return g_policy->parties_to_form(shard.ready.size(), shard.instances->free_count(), shard.arrival_done);
+}
+
+// Start as many parties as the policy asks for, each with the party and
+// instance it picks, and append them to formed. Party ids are unique over
+// all shards (shard s numbers s + 1, s + 1 + K, ...; 1, 2, ... with one).
+// Call while holding match_mutex; the caller starts the runs.
+void form_parties(Shard& shard, Clock::time_point now, std::vector<PartyJob>& formed) {
+    auto time_served = [&shard](int id) { return shard.instance_stats[id].time_served; };
+    for (int count = parties_to_form(shard); count > 0; --count) {
+        int instance_id = g_policy->pick_instance(*shard.instances, time_served);
+        int bucket = g_policy->pick_party(shard.ready);
+        if (instance_id < 0 || bucket < 0 || !shard.instances->try_acquire(instance_id)) return;
+        // only fails if an arrival is still writing one of the players; its wake-up retries
+        PendingParty party;
+        if (!form_party(shard, now, bucket, party)) {
+            shard.instances->release(instance_id);
+            return;
+        }
+        int party_id = shard.index + 1 + static_cast<int>(g_shards.size()) * shard.parties_formed++;
+        formed.push_back({party_id, instance_id, party.run_time});
+    }
+}
+
+// Matchmaker (one thread per shard, on the shard's cpus): sleep until an
+// arrival, a migration or a finished run lets the policy start parties,
+// then hand them to the shard's instance workers (one per instance).
+void matchmaker_thread_func(Shard* shard) {
+    pin_to_shard(*shard);
+    WorkerPool<PartyJob> instance_workers(
+        shard->instances->size(), [shard](int, const PartyJob& job) { run_dungeon(*shard, job); },
+        [shard](int) { pin_to_shard(*shard); });
+
+    std::vector<PartyJob> formed;
     {
-        std::lock_guard<std::mutex> data_lock(g_data_mutex);
-        for (int i = 0; i < g_max_instances; ++i) {
-            if (g_instance_status[i] == "empty") {
-                instance_id = i;
-                g_instance_status[i] = "active";
-                break;
+        std::unique_lock<std::mutex> lock(shard->match_mutex);
+        while (true) {
+            shard->match_cv.wait(lock, [shard] {
+                record_ready_parties(*shard, Clock::now());
+                return parties_to_form(*shard) > 0 || (shard->arrival_done && !party_available(*shard));
+            });
+            // arrivals are over and the leftovers can't make a party: we're done
+            if (!party_available(*shard)) break;
+
+            form_parties(*shard, Clock::now(), formed);
+            lock.unlock();
+            for (PartyJob& job : formed) instance_workers.push(job);
+            formed.clear();
+            lock.lock();
+        }
+    }
+
+    // wait for the parties still running
+    instance_workers.close();
+    instance_workers.join();
+}
+
+// Shard balancing (--shards=K > 1)
+
+std::mutex g_balance_mutex;
+std::condition_variable g_balance_cv;      // signaled when the last producer is done
+
+// Players a party takes per role
+const long long kSeats[PlayerQueues::kRoleCount] = {1, 1, 3};
+
+// Parties count[] could form, ignoring role skip (-1: none)
+long long parties_without(const long long count[], int skip) {
+    long long parties = -1;
+    for (int r = 0; r < PlayerQueues::kRoleCount; ++r) {
+        if (r == skip) continue;
+        long long p = count[r] / kSeats[r];
+        if (parties < 0 || p < parties) parties = p;
+    }
+    return parties;
+}
+
+void queue_counts(const Shard& shard, long long count[]) {
+    PlayerQueues::Counts c = shard.players->counts();
+    count[PlayerQueues::kTank] = c.tanks;
+    count[PlayerQueues::kHealer] = c.healers;
+    count[PlayerQueues::kDps] = c.dps;
+}
+
+// Players popped for a migration whose destination filled up before the
+// push (arrivals don't take match_mutex, so they can race into the room
+// that was checked). Balancer only; retried at the start of every pass.
+struct StrandedPlayer {
+    int from;
+    int to;                                // where they were headed
+    PlayerQueues::Role role;
+    Player player;
+};
+std::vector<StrandedPlayer> g_stranded;
+long long g_stranded_dropped = 0;          // no shard had room on the last pass
+
+// Queue the stranded players where they were headed; on the last pass, at
+// any shard with room (and count the rest as turned away).
+void requeue_stranded(Clock::time_point now, bool last) {
+    const int shards = static_cast<int>(g_shards.size());
+    std::vector<StrandedPlayer> still;
+    for (const StrandedPlayer& p : g_stranded) {
+        bool placed = false;
+        for (int k = 0; k < (last ? shards : 1) && !placed; ++k) {
+            int to = (p.to + k) % shards;
+            placed = g_shards[to]->players->put(p.role, p.player);
+            if (!placed) continue;
+            g_shards[to]->migrated_in++;
+            log_event(QueueEvent::kMigrate, now, p.from, to, p.role, 1);
+            wake_matchmaker(*g_shards[to]);
+        }
+        if (placed) continue;
+        if (last) ++g_stranded_dropped;
+        else still.push_back(p);
+    }
+    g_stranded.swap(still);
+}
+
+// One balancer pass. Per role, a shard's surplus is the players it can't
+// put in a party (more than its other roles can match), and a shard is
+// starved for a role if its other roles could make more parties with more
+// of it. Surplus goes to the starved shards, longest-waiting first, keeping
+// their arrival times. Taking only surplus never lowers what the source can
+// form, so its ready parties stay valid. Tanks and healers are what usually
+// runs short, but DPS are balanced the same way.
+// While arrivals go on, a shard only gets players for parties its free
+// instances could start now (so busy shards don't trade their backlogs
+// back and forth); the last pass (last = true) moves all that helps.
+// The queues have one consumer each, so the balancer pops under the source's
+// match_mutex (and only while the destination has room); pushes are
+// lock-free like arrivals.
+// Returns the players moved.
+long long balance_shards(Clock::time_point now, bool last) {
+    const int shards = static_cast<int>(g_shards.size());
+    std::vector<long long> counts(shards * PlayerQueues::kRoleCount);
+    long long moved_total = 0;
+    requeue_stranded(now, last);
+    for (int r = 0; r < PlayerQueues::kRoleCount; ++r) {
+        const PlayerQueues::Role role = static_cast<PlayerQueues::Role>(r);
+        for (int s = 0; s < shards; ++s) queue_counts(*g_shards[s], &counts[s * PlayerQueues::kRoleCount]);
+
+        for (int to = 0; to < shards; ++to) {
+            Shard& dst = *g_shards[to];
+            long long* want = &counts[to * PlayerQueues::kRoleCount];
+            long long parties = parties_without(want, r);
+            if (!last) {
+                long long startable = std::max<long long>(parties_without(want, -1), dst.instances->free_count());
+                parties = std::min(parties, startable);
+            }
+            long long need = kSeats[r] * parties - want[r];
+            bool got = false;
+            need = std::min(need, dst.players->room(role));
+            for (int from = 0; from < shards && need > 0; ++from) {
+                if (from == to) continue;
+                Shard& src = *g_shards[from];
+                long long moved = 0;
+                {
+                    std::lock_guard<std::mutex> lock(src.match_mutex);
+                    long long have[PlayerQueues::kRoleCount];
+                    queue_counts(src, have);
+                    long long surplus = have[r] - kSeats[r] * parties_without(have, -1);
+                    Player player;
+                    while (moved < std::min(surplus, need) && dst.players->room(role) > 0 &&
+                           src.players->try_take(role, player)) {
+                        if (!dst.players->put(role, player)) {
+                            // arrivals took the room first: hold the player for the next pass
+                            g_stranded.push_back({from, to, role, player});
+                            src.migrated_out++;
+                            need = 0;
+                            break;
+                        }
+                        ++moved;
+                    }
+                }
+                if (moved == 0) continue;
+                counts[from * PlayerQueues::kRoleCount + r] -= moved;
+                want[r] += moved;
+                need -= moved;
+                src.migrated_out += moved;
+                dst.migrated_in += moved;
+                moved_total += moved;
+                got = true;
+                log_event(QueueEvent::kMigrate, now, from, to, r, static_cast<int>(moved));
             }
+            if (got) wake_matchmaker(dst);
         }
     }
+    return moved_total;
+}
 
-    // print entry
-    {
-        std::lock_guard<std::mutex> cout_lock(g_cout_mutex);
-        std::cout << "[Party " << party_id << "] entered Instance " << instance_id
-                  << ". (Running for " << duration << "s)\n";
-        print_status();
+// Arrivals and balancing are over: let every matchmaker finish
+void finish_arrivals() {
+    for (auto& shard : g_shards) {
+        {
+            std::lock_guard<std::mutex> lock(shard->match_mutex);
+            shard->arrival_done = true;
+        }
+        shard->match_cv.notify_one();
     }
+}
 
-    // simulate run
-    std::this_thread::sleep_for(std::chrono::seconds(duration));
-
-    // finish and update stats
-    if (instance_id >= 0) {
-        std::lock_guard<std::mutex> data_lock(g_data_mutex);
-        g_instance_status[instance_id] = "empty";
-        g_parties_served[instance_id]++;
-        g_time_served[instance_id] += duration;
-    } else {
-        std::lock_guard<std::mutex> cout_lock(g_cout_mutex);
-        std::cout << "[Party " << party_id << "] ERROR: no instance to release.\n";
+// Balancer thread: a pass every period, and a last one once every producer
+// is done (after that nothing changes a shard's surplus, and nothing is
+// left stranded), then finish.
+void balancer_thread_func(Clock::duration period) {
+    std::unique_lock<std::mutex> lock(g_balance_mutex);
+    bool last = false;
+    while (!last) {
+        last = g_balance_cv.wait_for(lock, period, [] { return g_producers_left.load() == 0; });
+        lock.unlock();
+        balance_shards(Clock::now(), last);
+        lock.lock();
     }
+    lock.unlock();
+    finish_arrivals();
+}
 
-    // print finish
-    {
-        std::lock_guard<std::mutex> cout_lock(g_cout_mutex);
-        std::cout << "[Party " << party_id << "] finished Instance " << instance_id << ".\n";
-        print_status();
+// Arrivals
+
+// g_start_time + s seconds
+Clock::time_point at_time(double s) {
+    return g_start_time + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s));
+}
+
+// Queue one batch of players who joined the shard at time arrived. Takes
+// no lock; the caller wakes the matchmaker.
+void add_arrivals(Shard& shard, const ArrivalBatch& batch, Clock::time_point arrived, ProducerStats& stats) {
+    log_event(QueueEvent::kArrival, arrived, 0, 0, batch.tanks, batch.healers, batch.dps);
+
+    long long wanted = batch.tanks + batch.healers + batch.dps;
+    long long queued = shard.players->add(PlayerQueues::kTank, batch.tanks, arrived) +
+                       shard.players->add(PlayerQueues::kHealer, batch.healers, arrived) +
+                       shard.players->add(PlayerQueues::kDps, batch.dps, arrived);
+    stats.arrived += queued;
+    stats.turned_away += wanted - queued;
+    if (queued < wanted) log_event(QueueEvent::kTurnedAway, arrived, 0, 0, static_cast<int>(wanted - queued));
+}
+
+// The last producer (over all shards) is done: with one shard that ends
+// the arrivals, with more the balancer does a last pass first
+void producers_done() {
+    if (g_shards.size() == 1) {
+        finish_arrivals();
+        return;
+    }
+    { std::lock_guard<std::mutex> lock(g_balance_mutex); }
+    g_balance_cv.notify_one();
+}
+
+// Arrival producer: sleep until each batch is due, then queue it. Batches
+// that are already due (high rates) go in back to back, and the matchmaker
+// is woken every 256 players or 1 ms, and before any longer sleep.
+void producer_thread_func(Shard* shard, ArrivalStream stream, int producer) {
+    using namespace std::chrono_literals;
+    pin_to_shard(*shard);
+    ProducerStats& stats = shard->producer_stats[producer];
+    ArrivalBatch batch;
+    long long unannounced = 0;
+    Clock::time_point last_wake = Clock::now();
+    while (stream.next(batch)) {
+        Clock::time_point due = at_time(batch.at_s);
+        Clock::time_point now = Clock::now();
+        if (due > now) {
+            if (unannounced > 0 && due - now > 1ms) {
+                wake_matchmaker(*shard);
+                unannounced = 0;
+                last_wake = now;
+            }
+            std::this_thread::sleep_until(due);
+            now = Clock::now();
+        }
+        add_arrivals(*shard, batch, due, stats);
+        unannounced += batch.tanks + batch.healers + batch.dps;
+        if (unannounced >= 256 || now - last_wake >= 1ms) {
+            wake_matchmaker(*shard);
+            unannounced = 0;
+            last_wake = now;
+        }
     }
 
-    // release the slot
-    g_instance_slots->release();
+    wake_matchmaker(*shard);
+    if (g_producers_left.fetch_sub(1) == 1) producers_done();
 }
 
-// Try to form a party from the shared player pool.
-// Returns true and consumes players if a party can be formed.
-bool try_form_party() {
-    std::lock_guard<std::mutex> lock(g_data_mutex);
-    if (g_tanks >= 1 && g_healers >= 1 && g_dps >= 3) {
-        g_tanks -= 1;
-        g_healers -= 1;
-        g_dps -= 3;
-        return true;
-    }
-    return false;
+// Simulation (--sim)
+
+// Something that happens at a virtual time: a producer's batch of arrivals,
+// a party finishing its run, or a balancer pass
+struct SimEvent {
+    enum class Kind { Arrival, Finish, Balance } kind = Kind::Arrival;
+    PartyJob job;                          // Finish only
+    ArrivalBatch batch;                    // Arrival only
+    int shard = 0;                         // Arrival, Finish
+    int producer = 0;                      // Arrival only
+};
+
+// Runs the same queue on a virtual clock: no thread sleeps, arrivals,
+// finished runs and balancer passes (every balance_s) are events taken in
+// time order, and after each one every shard's matchmaker forms parties
+// exactly like the threaded run does (same policy).
+// Virtual time is g_start_time + seconds, so the waits come out in virtual ms.
+// The reporter (if any) is polled after every step with the virtual time.
+// Returns the virtual time of the last event, in seconds.
+double run_simulation(std::vector<std::vector<ArrivalStream>>& streams, double balance_s, StatusReporter* reporter) {
+    const int shards = static_cast<int>(g_shards.size());
+    EventQueue<SimEvent> events;
+    double now_s = 0;
+    ArrivalBatch batch;
+    int producers_left = 0;
+    for (int s = 0; s < shards; ++s) {
+        for (int p = 0; p < static_cast<int>(streams[s].size()); ++p) {
+            if (!streams[s][p].next(batch)) continue;
+            events.push(batch.at_s, {SimEvent::Kind::Arrival, {}, batch, s, p});
+            ++producers_left;
+        }
+    }
+    if (producers_left == 0) {
+        if (shards > 1) balance_shards(at_time(0), true);
+        finish_arrivals();
+    }
+    bool balance_queued = producers_left > 0 && shards > 1;
+    if (balance_queued) events.push(balance_s, {SimEvent::Kind::Balance, {}, {}, 0, 0});
+
+    std::vector<PartyJob> formed;
+    while (true) {
+        for (int s = 0; s < shards; ++s) {
+            Shard& shard = *g_shards[s];
+            {
+                std::lock_guard<std::mutex> lock(shard.match_mutex);
+                record_ready_parties(shard, at_time(now_s));
+                form_parties(shard, at_time(now_s), formed);
+            }
+            for (const PartyJob& job : formed) {
+                start_party(shard, job, at_time(now_s));
+                events.push(now_s + job.duration, {SimEvent::Kind::Finish, job, {}, s, 0});
+            }
+            formed.clear();
+        }
+        if (reporter) reporter->poll(at_time(now_s));
+
+        // a leftover balancer pass (after the last one) mustn't move the clock
+        if (events.empty() || (balance_queued && producers_left == 0 && events.size() == 1)) break;
+        SimEvent event = events.pop(now_s);
+        if (event.kind == SimEvent::Kind::Finish) {
+            finish_party(*g_shards[event.shard], event.job, at_time(now_s));
+            continue;
+        }
+        if (event.kind == SimEvent::Kind::Balance) {
+            // the last pass comes with the last arrival
+            balance_queued = producers_left > 0;
+            if (!balance_queued) continue;
+            balance_shards(at_time(now_s), false);
+            events.push(now_s + balance_s, {SimEvent::Kind::Balance, {}, {}, 0, 0});
+            continue;
+        }
+        Shard& shard = *g_shards[event.shard];
+        add_arrivals(shard, event.batch, at_time(now_s), shard.producer_stats[event.producer]);
+        if (streams[event.shard][event.producer].next(batch)) {
+            events.push(batch.at_s, {SimEvent::Kind::Arrival, {}, batch, event.shard, event.producer});
+        } else if (--producers_left == 0) {
+            if (shards > 1) balance_shards(at_time(now_s), true);
+            finish_arrivals();
+        }
+    }
+    if (reporter) reporter->flush(at_time(now_s));
+    return now_s;
 }
 
-// Arrival thread: periodically add random new players to the pool.
-void arrival_thread_func(int cycles, int min_sleep_s, int max_sleep_s) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> sleep_dis(min_sleep_s, max_sleep_s);
-    std::uniform_int_distribution<> add_tanks(0, 2);
-    std::uniform_int_distribution<> add_heals(0, 2);
-    std::uniform_int_distribution<> add_dps(0, 6);
+// One queue run
 
-    for (int i = 0; i < cycles; ++i) {
-        int s = sleep_dis(gen);
-        std::this_thread::sleep_for(std::chrono::seconds(s));
+// Say so if the reporter couldn't keep up (the events are gone, the stats aren't)
+void report_dropped_events() {
+    if (g_events && g_events->dropped_count() > 0) {
+        std::cout << "(" << g_events->dropped_count() << " events dropped: the event ring was full)\n";
+    }
+}
 
-        int at = add_tanks(gen);
-        int ah = add_heals(gen);
-        int ad = add_dps(gen);
+// Shard s's even share of total (the first total % shards get one more)
+long long shard_share(long long total, int s, int shards) {
+    return total / shards + (s < total % shards ? 1 : 0);
+}
 
-        {
-            std::lock_guard<std::mutex> lock(g_data_mutex);
-            g_tanks += at;
-            g_healers += ah;
-            g_dps += ad;
+// Runs one queue from start to finish: n instances and the starting
+// players split evenly over options.shards shards, then the arrivals of
+// options.load (--producers per shard; the rate, or the classic rounds,
+// split over the shards). Resets
+// all shared state first, so the stress benchmark can run it again and again.
+// Returns the seconds from the start to the last arrival or finish (virtual when simulated).
+// events goes to the reporter (nullptr: no events).
+double run_queue(const Options& options, unsigned seed, int n, int t1, int t2, long long tanks, long long healers,
+                 long long dps, std::size_t queue_room, std::ostream* events) {
+    const int shards = options.shards;
+    const int producers = options.load.producers;
+    const bool pin = !options.simulate && (options.pin < 0 ? shards > 1 : options.pin == 1); // --sim runs on one thread
+    g_max_instances = n;
+
+    // classic rounds are dealt out over the shards; the other shapes split the rate
+    LoadProfile load = options.load;
+    const bool classic = load.shape == LoadProfile::Shape::Classic;
+    if (!classic) load.rate /= shards;
+
+    // the shards: instances, stats, queues (room for the arrivals on top),
+    // run times drawn as parties become formable, one arrival stream per producer
+    g_shards.clear();
+    g_stranded.clear();
+    g_stranded_dropped = 0;
+    std::vector<std::vector<ArrivalStream>> streams(shards);
+    int first_instance = 0;
+    for (int s = 0; s < shards; ++s) {
+        auto shard = std::make_unique<Shard>();
+        const int count = static_cast<int>(shard_share(n, s, shards));
+        const unsigned shard_seed = seed + 1000u * static_cast<unsigned>(s);
+        shard->index = s;
+        shard->first_instance = first_instance;
+        first_instance += count;
+        if (pin) shard_cpus(s, shards, shard->first_cpu, shard->cpu_count);
+        shard->instances = std::make_unique<InstanceAllocator>(count);
+        shard->instance_stats.assign(count, InstanceStats{});
+        shard->players = std::make_unique<PlayerQueues>(
+            shard_share(tanks, s, shards) + queue_room, shard_share(healers, s, shards) + queue_room,
+            shard_share(dps, s, shards) + queue_room, (static_cast<std::uint64_t>(s) << 40) + 1);
+        shard->run_times = RunTimes(shard_seed + 1, t1, t2);
+        shard->ready.reset(t1, t2);
+        shard->producer_stats.assign(producers, ProducerStats{});
+        for (int p = 0; p < producers; ++p) {
+            if (classic) streams[s].emplace_back(load, seed + 2 + p, s, shards);
+            else streams[s].emplace_back(load, shard_seed + 2 + p);
         }
+        g_shards.push_back(std::move(shard));
+    }
 
-        {
-            std::lock_guard<std::mutex> cout_lock(g_cout_mutex);
-            std::cout << "[Arrival] added " << at << "T " << ah << "H " << ad << "D\n";
+    // initialize the player pools from the initial input
+    g_start_time = Clock::now();
+    for (int s = 0; s < shards; ++s) {
+        Shard& shard = *g_shards[s];
+        std::lock_guard<std::mutex> lock(shard.match_mutex);
+        shard.players->add(PlayerQueues::kTank, shard_share(tanks, s, shards), g_start_time);
+        shard.players->add(PlayerQueues::kHealer, shard_share(healers, s, shards), g_start_time);
+        shard.players->add(PlayerQueues::kDps, shard_share(dps, s, shards), g_start_time);
+        record_ready_parties(shard, g_start_time);
+    }
+
+    // the reporter is the only thing that writes events out
+    std::unique_ptr<EventLog> event_log;
+    std::unique_ptr<StatusReporter> reporter;
+    g_events = nullptr;
+    if (events) {
+        EventFormat format = EventFormat::Text;
+        parse_event_format(options.events, format);
+        std::vector<const InstanceAllocator*> instances;
+        std::vector<const PlayerQueues*> players;
+        for (auto& shard : g_shards) {
+            instances.push_back(shard->instances.get());
+            players.push_back(shard->players.get());
         }
+        event_log = std::make_unique<EventLog>(1 << 16);
+        reporter = std::make_unique<StatusReporter>(
+            *event_log, instances, players, format, *events, g_start_time,
+            std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(options.report_ms)));
+        g_events = event_log.get();
     }
 
-    // signal arrival finished
-    {
-        std::lock_guard<std::mutex> lock(g_data_mutex);
-        g_arrival_done = true;
+    if (options.simulate) {
+        double elapsed_s = run_simulation(streams, options.balance_ms / 1000, reporter.get());
+        report_dropped_events();
+        g_events = nullptr;
+        return elapsed_s;
+    }
+    if (reporter) reporter->start();
+
+    // a matchmaker (with its instance workers) and the arrival producers per
+    // shard, plus the balancer when there is more than one shard
+    g_producers_left = shards * producers;
+    std::vector<std::thread> threads;
+    for (auto& shard : g_shards) threads.emplace_back(matchmaker_thread_func, shard.get());
+    for (int s = 0; s < shards; ++s) {
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back(producer_thread_func, g_shards[s].get(), streams[s][p], p);
+        }
+    }
+    if (shards > 1) {
+        threads.emplace_back(balancer_thread_func, std::chrono::duration_cast<Clock::duration>(
+                                                        std::chrono::duration<double, std::milli>(options.balance_ms)));
+    }
+
+    // wait for the producers and the matchmakers (who wait for their parties)
+    for (std::thread& t : threads) t.join();
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - g_start_time).count();
+    if (reporter) reporter->stop();
+    report_dropped_events();
+    g_events = nullptr;
+    return elapsed_s;
+}
+
+// p-th percentile of sorted values (nearest rank)
+double percentile_of(const std::vector<double>& sorted, double p) {
+    std::size_t rank = static_cast<std::size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[rank];
+}
+
+// Totals over all shards
+struct QueueTotals {
+    int parties = 0;
+    long long arrived = 0;
+    long long turned_away = 0;
+    std::vector<double> match_latency_ms;  // sorted
+    WaitHistogram player_waits[PlayerQueues::kRoleCount];
+};
+
+QueueTotals queue_totals() {
+    QueueTotals totals;
+    totals.turned_away = g_stranded_dropped;
+    for (auto& shard : g_shards) {
+        totals.parties += shard->parties_formed;
+        for (const ProducerStats& p : shard->producer_stats) {
+            totals.arrived += p.arrived;
+            totals.turned_away += p.turned_away;
+        }
+        totals.match_latency_ms.insert(totals.match_latency_ms.end(), shard->match_latency_ms.begin(),
+                                       shard->match_latency_ms.end());
+        for (int r = 0; r < PlayerQueues::kRoleCount; ++r) totals.player_waits[r].merge(shard->player_waits[r]);
+    }
+    std::sort(totals.match_latency_ms.begin(), totals.match_latency_ms.end());
+    return totals;
+}
+
+// Print the final per-instance, per-shard, overall and per-role summary
+void print_summary(bool simulate, double elapsed_s, double wall_ms) {
+    std::cout << "\n=== QUEUE FINISHED: FINAL SUMMARY ===\n";
+    double total_time_all = 0;
+    int total_parties_all = 0;
+
+    for (auto& shard : g_shards) {
+        for (int i = 0; i < shard->instances->size(); ++i) {
+            const InstanceStats& stats = shard->instance_stats[i];
+            std::cout << "Instance " << shard->first_instance + i << ":\n";
+            std::cout << "  - Parties Served:   " << stats.parties_served << "\n";
+            std::cout << "  - Total Time Served: " << stats.time_served << "s\n";
+            if (elapsed_s > 0) {
+                std::cout << "  - Utilization:      " << 100.0 * stats.time_served / elapsed_s << "%\n";
+            }
+            total_parties_all += stats.parties_served;
+            total_time_all += stats.time_served;
+        }
+    }
+    if (g_shards.size() > 1) {
+        std::cout << "-------------------------------------\n";
+        std::cout << "Shards:\n";
+        for (auto& shard : g_shards) {
+            int parties = 0;
+            for (const InstanceStats& stats : shard->instance_stats) parties += stats.parties_served;
+            std::cout << "  - Shard " << shard->index << ": instances " << shard->first_instance << "-"
+                      << shard->first_instance + shard->instances->size() - 1 << ", " << parties << " parties";
+            if (elapsed_s > 0) std::cout << " (" << parties / elapsed_s << "/s)";
+            std::cout << ", players moved in " << shard->migrated_in << " / out " << shard->migrated_out;
+            if (shard->cpu_count > 0) {
+                std::cout << ", cpus " << shard->first_cpu << "-" << shard->first_cpu + shard->cpu_count - 1;
+            }
+            std::cout << "\n";
+        }
+    }
+    QueueTotals totals = queue_totals();
+    std::cout << "-------------------------------------\n";
+    std::cout << "Overall:\n";
+    std::cout << "  - Total Parties Served: " << total_parties_all << "\n";
+    std::cout << "  - Combined Time Served: " << total_time_all << "s\n";
+    if (elapsed_s > 0) {
+        // share of instance-time in use, and parties finished per second
+        std::cout << "  - Utilization:        " << 100.0 * total_time_all / (elapsed_s * g_max_instances) << "%\n";
+        std::cout << "  - Throughput:         " << total_parties_all / elapsed_s << " parties/s\n";
+    }
+    std::cout << "  - Players Arrived:    " << totals.arrived;
+    if (totals.turned_away > 0) std::cout << " (" << totals.turned_away << " turned away, queue full)";
+    std::cout << "\n";
+    const std::vector<double>& sorted = totals.match_latency_ms;
+    if (!sorted.empty()) {
+        double sum = 0;
+        for (double ms : sorted) sum += ms;
+        // from enough players being queued to the party getting an instance
+        std::cout << "  - Avg Time to Match:  " << sum / sorted.size() << " ms (max " << sorted.back() << " ms)\n";
+        std::cout << "  - Match Wait p50/p90/p99: " << percentile_of(sorted, 50) << " / " << percentile_of(sorted, 90)
+                  << " / " << percentile_of(sorted, 99) << " ms\n";
+    }
+    if (simulate) std::cout << "  - Simulated Time:   " << elapsed_s << "s (took " << wall_ms << " ms)\n";
+    std::cout << "-------------------------------------\n";
+
+    // per role: how long players queued before their party formed, and who never got one
+    std::cout << "Player Waits (queue join -> party formed):\n";
+    static const char* kRoleNames[PlayerQueues::kRoleCount] = {"Tanks", "Healers", "DPS"};
+    Clock::time_point end_time = simulate ? at_time(elapsed_s) : Clock::now();
+    for (int r = 0; r < PlayerQueues::kRoleCount; ++r) {
+        const WaitHistogram& h = totals.player_waits[r];
+        std::cout << "  - " << kRoleNames[r] << ": " << h.count() << " matched";
+        if (h.count() > 0) {
+            std::cout << ", avg " << h.average() << " ms, p50 <= " << h.percentile(50) << " ms, p99 <= "
+                      << h.percentile(99) << " ms, max " << h.max() << " ms";
+        }
+        std::cout << "\n";
+        h.print_buckets(std::cout, "      ");
+
+        long long left = 0;
+        const Player* oldest = nullptr;
+        for (auto& shard : g_shards) {
+            long long count[PlayerQueues::kRoleCount];
+            queue_counts(*shard, count);
+            left += count[r];
+            const Player* p = shard->players->oldest(static_cast<PlayerQueues::Role>(r));
+            if (p && (!oldest || p->arrived < oldest->arrived)) oldest = p;
+        }
+        if (left > 0) {
+            std::cout << "      still queued: " << left;
+            if (oldest) {
+                std::cout << " (longest " << std::chrono::duration<double, std::milli>(end_time - oldest->arrived).count()
+                          << " ms)";
+            }
+            std::cout << "\n";
+        }
+    }
+    std::cout << "=====================================\n";
+}
+
+// --stress: the matchmaker under a Poisson load at each rate (players/s),
+// with the instances and run times from stdin, no starting queue and the
+// producers/duration/mix/policy/shards options. One table row per rate.
+void run_stress(Options options, unsigned seed, int n, int t1, int t2) {
+    std::vector<double> rates = options.stress_rates;
+    if (rates.empty()) rates = {1e4, 3e4, 1e5, 3e5, 1e6};
+    options.load.shape = LoadProfile::Shape::Poisson;
+    if (!options.duration_set) options.load.duration = 3;
+    g_log_events = false;
+
+    std::cout << "=== Matchmaker Stress: " << n << " instances, " << t1 << "-" << t2 << "s runs, "
+              << options.load.producers << " producers";
+    if (options.shards > 1) std::cout << " x " << options.shards << " shards";
+    std::cout << ", " << options.load.duration << "s per rate, policy " << g_policy->name() << " ===\n";
+    std::cout << std::setw(12) << "offered/s" << std::setw(12) << "queued/s" << std::setw(12) << "parties/s"
+              << std::setw(10) << "dropped" << std::setw(12) << "match p50" << std::setw(12) << "match p99"
+              << std::setw(13) << "player p99" << "   (ms)\n";
+    for (double rate : rates) {
+        options.load.rate = rate;
+        // room for the whole run's arrivals (up to 1M per role and shard), so a slow matchmaker shows up as latency
+        double arrivals = rate * options.load.duration / options.shards;
+        std::size_t room = std::max(options.queue_room, static_cast<std::size_t>(std::min(arrivals, double(1 << 20))));
+        double elapsed_s = run_queue(options, seed, n, t1, t2, 0, 0, 0, room, nullptr);
+
+        QueueTotals totals = queue_totals();
+        const std::vector<double>& sorted = totals.match_latency_ms;
+        double player_p99 = 0;
+        for (const WaitHistogram& h : totals.player_waits) player_p99 = std::max(player_p99, h.percentile(99));
+        double span = elapsed_s > 0 ? elapsed_s : 1;
+
+        std::cout << std::setw(12) << rate << std::setw(12) << totals.arrived / span << std::setw(12)
+                  << totals.parties / span << std::setw(10) << totals.turned_away << std::setw(12)
+                  << (sorted.empty() ? 0 : percentile_of(sorted, 50)) << std::setw(12)
+                  << (sorted.empty() ? 0 : percentile_of(sorted, 99)) << std::setw(13) << player_p99 << "\n";
     }
 }
 
 // Main Program Execution
 
-int main() {
+// Options (--key=value or a --config=FILE, see options.h); the queue itself
+// is still read from stdin:
+//   --sim        run on a virtual clock instead of sleeping (see run_simulation)
+//   --seed=N     fixed seed for arrivals and run times (default: random)
+//   --quiet      only print the final summary
+//   --policy=P   fifo (default), serf, least-loaded or batch (see policy.h)
+//   --batch=N    parties per batch for --policy=batch (default 4, at most n)
+//   --load=...   arrivals: classic (default), poisson, bursty, diurnal, with
+//                --producers, --rate, --duration, --mix, --burst, --day (see load_generator.h)
+//   --stress     matchmaker throughput/latency sweep instead of one queue
+//   --shards=K   K independent matchmaking shards with a balancer between
+//                them, --pin, --balance-ms (see Shard and balance_shards)
+int main(int argc, char* argv[]) {
+    Options options;
+    std::string error;
+    if (!parse_options(argc, argv, options, error)) {
+        std::cout << "Error: " << error << ". Exiting.\n";
+        return 1;
+    }
+    g_log_events = !options.quiet;
+    if (options.events == "binary" && options.events_file.empty() && !options.quiet) {
+        std::cout << "Error: --events=binary needs --events-file=PATH. Exiting.\n";
+        return 1;
+    }
+    unsigned seed = options.seeded ? options.seed : std::random_device{}();
     // 1. Get user input
     int n, tanks, healers, dps, t1, t2;
 
@@ -196,6 +895,11 @@ int main() {
         std::cout << "Error: max concurrent instances 'n' must be >= 1. Exiting.\n";
         return 1;
     }
+    if (n < options.shards) {
+        std::cout << "Error: " << options.shards << " shards need at least as many instances (n = " << n
+                  << "). Exiting.\n";
+        return 1;
+    }
     if (t1 < 0) t1 = 0;
     if (t2 < 0) t2 = 0;
     if (t1 > t2) {
@@ -210,84 +914,70 @@ int main() {
         std::cout << "Error: player counts must be non-negative. Exiting.\n";
         return 1;
     }
+    if (tanks > PlayerQueues::kMaxPerRole || healers > PlayerQueues::kMaxPerRole || dps > PlayerQueues::kMaxPerRole) {
+        std::cout << "Error: at most " << PlayerQueues::kMaxPerRole << " players per role can queue. Exiting.\n";
+        return 1;
+    }
 
     // 2. Prepare shared resources
-    g_max_instances = n;
-
-    // semaphore
-    g_instance_slots = new CountingSemaphore(n);
-
-    // instance arrays
-    g_instance_status.resize(n, "empty");
-    g_parties_served.resize(n, 0);
-    g_time_served.resize(n, 0.0);
+    // scheduling policy
+    int batch_size = std::min(options.batch, n / options.shards); // a bigger batch could never start (smallest shard)
+    g_policy = make_policy(options.policy, batch_size);
+    if (!g_policy) {
+        std::cout << "Error: unknown policy '" << options.policy << "' (fifo, serf, least-loaded, batch). Exiting.\n";
+        return 1;
+    }
 
-    // initialize player pool from initial input
-    {
-        std::lock_guard<std::mutex> lock(g_data_mutex);
-        g_tanks = tanks;
-        g_healers = healers;
-        g_dps = dps;
-        g_arrival_done = false;
+    if (options.stress) {
+        run_stress(options, seed, n, t1, t2);
+        return 0;
     }
 
+    const LoadProfile& load = options.load;
     std::cout << "=== LFG Queue Starting ===\n";
     std::cout << "Max concurrent instances: " << n << "\n";
     std::cout << "Player pool initial: " << tanks << "T, " << healers << "H, " << dps << "D\n";
-    std::cout << "(A background arrival thread will add players randomly.)\n";
+    std::cout << "Scheduling policy: " << g_policy->name();
+    if (options.policy == "batch") std::cout << " (" << batch_size << " parties)";
+    std::cout << "\n";
+    if (options.shards > 1) {
+        bool pinned = options.pin != 0 && !options.simulate; // on by default with shards
+        std::cout << "Shards: " << options.shards << " (" << n / options.shards << "+ instances and an even share of the "
+                  << "players and arrivals each, balancer every " << options.balance_ms << " ms"
+                  << (pinned ? ", pinned to cpus" : "") << ")\n";
+    }
+    if (options.simulate) std::cout << "(Simulated: virtual clock, seed " << seed << ", arrivals as in the real run.)\n";
+    if (load.shape == LoadProfile::Shape::Classic && load.producers == 1 && options.shards == 1) {
+        std::cout << "(A background arrival thread will add players randomly.)\n";
+    } else if (load.shape == LoadProfile::Shape::Classic) {
+        std::cout << "(" << load.producers << (load.producers == 1 ? " arrival thread" : " arrival threads")
+                  << " will add players randomly" << (options.shards > 1 ? ", their rounds dealt out over the shards" : "")
+                  << ".)\n";
+    } else {
+        std::cout << "(" << load.producers << " arrival producers" << (options.shards > 1 ? " per shard" : "") << ", "
+                  << shape_name(load.shape) << " at " << load.rate << " players/s for " << load.duration << "s, mix "
+                  << load.mix[0] << ":" << load.mix[1] << ":" << load.mix[2] << ".)\n";
+    }
     std::cout << "============================\n\n";
 
-    // container for party threads
-    std::vector<std::thread> party_threads;
-
-    // start arrival thread (bonus): run a fixed number of cycles
-    std::thread arrival_thread(arrival_thread_func, 10, 1, 3); // 10 cycles, 1-3s sleeps
-
-    // continuously try to form parties while arrivals may still come
-    int next_party_id = 0;
-    while (true) {
-        // form as many parties as possible right now
-        bool formed_any = false;
-        while (try_form_party()) {
-            ++next_party_id;
-            party_threads.emplace_back(run_dungeon, next_party_id, t1, t2);
-            formed_any = true;
+    // events: stdout unless --events-file
+    std::ofstream events_file;
+    std::ostream* events = g_log_events ? &std::cout : nullptr;
+    if (events && !options.events_file.empty()) {
+        events_file.open(options.events_file, std::ios::binary);
+        if (!events_file) {
+            std::cout << "Error: could not open '" << options.events_file << "'. Exiting.\n";
+            return 1;
         }
-
-        // if arrival finished and we couldn't form any new party, we're done
-        {
-            std::lock_guard<std::mutex> lock(g_data_mutex);
-            if (g_arrival_done && !formed_any) break;
-        }
-
-        // wait a short while before retrying
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        events = &events_file;
     }
 
-    // wait for arrival thread and all party threads
-    arrival_thread.join();
-    for (auto& th : party_threads) th.join();
+    Clock::time_point wall_start = Clock::now();
+    double elapsed_s = run_queue(options, seed, n, t1, t2, tanks, healers, dps, options.queue_room, events);
+    double wall_ms = std::chrono::duration<double, std::milli>(Clock::now() - wall_start).count();
 
     // 6. Print Final Summary
-    std::cout << "\n=== QUEUE FINISHED: FINAL SUMMARY ===\n";
-    double total_time_all = 0;
-    int total_parties_all = 0;
-
-    for (int i = 0; i < g_max_instances; ++i) {
-        std::cout << "Instance " << i << ":\n";
-        std::cout << "  - Parties Served:   " << g_parties_served[i] << "\n";
-        std::cout << "  - Total Time Served: " << g_time_served[i] << "s\n";
-        total_parties_all += g_parties_served[i];
-        total_time_all += g_time_served[i];
-    }
-    std::cout << "-------------------------------------\n";
-    std::cout << "Overall:\n";
-    std::cout << "  - Total Parties Served: " << total_parties_all << "\n";
-    std::cout << "  - Combined Time Served: " << total_time_all << "s\n";
-    std::cout << "=====================================\n";
-
-    // 7. Cleanup
-    delete g_instance_slots;
+    print_summary(options.simulate, elapsed_s, wall_ms);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free ring: any number of threads push (one CAS to claim a
+// slot, then publish it), and a single consumer takes from the front in
+// FIFO order (the matchmaker for the player queues, the reporter for the
+// event log).
+// Each slot carries a sequence number (Vyukov's bounded queue), so a slot
+// that was claimed but not yet written is never handed out.
+template <typename T>
+class MpscRing {
+public:
+    explicit MpscRing(std::size_t min_capacity)
+        : capacity(std::bit_ceil(min_capacity < 2 ? std::size_t{2} : min_capacity)), mask(capacity - 1),
+          slots(new Slot[capacity]) {
+        for (std::size_t i = 0; i < capacity; ++i) slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // false if the ring is full
+    bool try_push(const T& value) {
+        std::size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[pos & mask];
+            std::size_t seq = slot.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // items queued (claimed slots, a push may still be writing the newest).
+    // head is read first, so a pop racing with this can't make it negative.
+    std::size_t size() const {
+        std::size_t h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_relaxed) - h;
+    }
+
+    std::size_t max_size() const { return capacity; }
+
+    // --- consumer only ---
+
+    // true if the first count items are written and can be taken
+    bool front_ready(std::size_t count) const {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < count; ++i) {
+            if (slots[(h + i) & mask].seq.load(std::memory_order_acquire) != h + i + 1) return false;
+        }
+        return true;
+    }
+
+    // the oldest item, nullptr if there is none (yet)
+    const T* front() const { return front_ready(1) ? &slots[head.load(std::memory_order_relaxed) & mask].value : nullptr; }
+
+    // call only after front_ready()
+    T pop() {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[h & mask];
+        T value = slot.value;
+        slot.seq.store(h + capacity, std::memory_order_release);
+        head.store(h + 1, std::memory_order_relaxed);
+        return value;
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> seq{0};
+        T value;
+    };
+
+    const std::size_t capacity;
+    const std::size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<std::size_t> tail{0}; // next slot to claim (producers)
+    alignas(64) std::atomic<std::size_t> head{0}; // next slot to take (consumer)
+};
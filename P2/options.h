@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "load_generator.h"
+
+// Run settings that don't come from the stdin prompts. Every one of them
+// can be given as --key=value on the command line, or as a key=value line in
+// a --config=FILE (# starts a comment); later settings win.
+//   sim, quiet              - flags (--sim, --quiet; =0 turns them off)
+//   seed=N                  - fixed RNG seeds (default: random)
+//   policy=P, batch=N       - scheduling, see policy.h
+//   load=SHAPE              - classic (default), poisson, bursty, diurnal
+//   producers=N             - arrival threads (default 1)
+//   rate=R, duration=S      - players/s over all producers, seconds of arrivals
+//   mix=T:H:D               - role weights (default 1:1:3)
+//   burst=PERIOD:FRACTION   - bursty shape (default 10:0.2)
+//   day=S                   - diurnal day length (default 60)
+//   queue=N                 - ring room per role on top of the initial queue
+//   stress[=R,R,...]        - matchmaker stress benchmark at these rates
+//   events=FORMAT           - text (default), json or binary, see status_reporter.h
+//   events-file=PATH        - write the events there instead of stdout (binary needs one)
+//   report-ms=N             - status snapshot period (default 1000)
+//   shards=K                - independent matchmaking shards (default 1), each
+//                             with n/K instances, its own queues and producers
+//   pin                     - pin each shard's threads to its own cpus (default: on with K > 1)
+//   balance-ms=N            - how often the balancer moves players between shards (default 100)
+struct Options {
+    bool simulate = false;
+    bool quiet = false;
+    bool seeded = false;
+    unsigned seed = 0;
+    std::string policy = "fifo";
+    int batch = 4;
+    LoadProfile load;
+    bool duration_set = false;
+    std::size_t queue_room = 1 << 16;
+    bool stress = false;
+    std::vector<double> stress_rates;
+    std::string events = "text";
+    std::string events_file;
+    double report_ms = 1000;
+    int shards = 1;
+    int pin = -1;                          // -1: pin when shards > 1
+    double balance_ms = 100;
+};
+
+namespace options_detail {
+
+inline bool parse_flag(const std::string& value, bool& out) {
+    if (value.empty() || value == "1" || value == "true" || value == "on") out = true;
+    else if (value == "0" || value == "false" || value == "off") out = false;
+    else return false;
+    return true;
+}
+
+inline bool parse_number(const std::string& value, double& out) {
+    char* end = nullptr;
+    out = std::strtod(value.c_str(), &end);
+    return !value.empty() && *end == '\0';
+}
+
+// "a:b:c" (or "a,b,c") into numbers
+inline bool parse_list(const std::string& value, char separator, std::vector<double>& out) {
+    out.clear();
+    std::stringstream in(value);
+    std::string item;
+    while (std::getline(in, item, separator)) {
+        double x = 0;
+        if (!parse_number(item, x)) return false;
+        out.push_back(x);
+    }
+    return !out.empty();
+}
+
+} // namespace options_detail
+
+inline bool load_options_file(const std::string& path, Options& options, std::string& error);
+
+// applies one setting; false (and error says why) if it isn't valid
+inline bool apply_option(const std::string& key, const std::string& value, Options& options, std::string& error) {
+    using namespace options_detail;
+    double x = 0;
+    std::vector<double> list;
+    bool ok = true;
+    if (key == "sim") ok = parse_flag(value, options.simulate);
+    else if (key == "quiet") ok = parse_flag(value, options.quiet);
+    else if (key == "seed") {
+        ok = parse_number(value, x) && x >= 0;
+        options.seeded = ok;
+        options.seed = static_cast<unsigned>(x);
+    } else if (key == "policy") options.policy = value;
+    else if (key == "batch") {
+        ok = parse_number(value, x) && x >= 1;
+        options.batch = static_cast<int>(x);
+    } else if (key == "load") ok = parse_shape(value, options.load.shape);
+    else if (key == "producers") {
+        ok = parse_number(value, x) && x >= 1 && x <= 256;
+        options.load.producers = static_cast<int>(x);
+    } else if (key == "rate") ok = parse_number(value, options.load.rate) && options.load.rate >= 0;
+    else if (key == "duration") {
+        ok = parse_number(value, options.load.duration) && options.load.duration > 0;
+        options.duration_set = true;
+    } else if (key == "mix") {
+        ok = parse_list(value, ':', list) && list.size() == 3 && list[0] >= 0 && list[1] >= 0 && list[2] >= 0 &&
+             list[0] + list[1] + list[2] > 0;
+        if (ok) for (int r = 0; r < 3; ++r) options.load.mix[r] = list[r];
+    } else if (key == "burst") {
+        ok = parse_list(value, ':', list) && list.size() == 2 && list[0] > 0 && list[1] > 0 && list[1] <= 1;
+        if (ok) {
+            options.load.burst_period = list[0];
+            options.load.burst_fraction = list[1];
+        }
+    } else if (key == "day") ok = parse_number(value, options.load.day_length) && options.load.day_length > 0;
+    else if (key == "queue") {
+        ok = parse_number(value, x) && x >= 0;
+        options.queue_room = static_cast<std::size_t>(x);
+    } else if (key == "stress") {
+        options.stress = true;
+        options.stress_rates.clear();
+        ok = value.empty() || parse_list(value, ',', options.stress_rates);
+    } else if (key == "events") {
+        options.events = value;
+        ok = value == "text" || value == "json" || value == "binary";
+    } else if (key == "events-file") {
+        options.events_file = value;
+        ok = !value.empty();
+    } else if (key == "report-ms") {
+        ok = parse_number(value, options.report_ms) && options.report_ms > 0;
+    } else if (key == "shards") {
+        ok = parse_number(value, x) && x >= 1 && x <= 64;
+        options.shards = static_cast<int>(x);
+    } else if (key == "pin") {
+        bool pin = false;
+        ok = parse_flag(value, pin);
+        options.pin = pin ? 1 : 0;
+    } else if (key == "balance-ms") {
+        ok = parse_number(value, options.balance_ms) && options.balance_ms > 0;
+    } else if (key == "config") {
+        return load_options_file(value, options, error);
+    } else {
+        error = "unknown option '" + key + "'";
+        return false;
+    }
+    if (!ok) error = "bad value '" + value + "' for '" + key + "'";
+    return ok;
+}
+
+// key=value lines; blank lines and # comments are skipped
+inline bool load_options_file(const std::string& path, Options& options, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "could not open config '" + path + "'";
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+        std::size_t last = line.find_last_not_of(" \t\r");
+        line = line.substr(first, last - first + 1);
+        std::size_t eq = line.find('=');
+        std::string key = line.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : line.substr(eq + 1);
+        if (!apply_option(key, value, options, error)) {
+            error = path + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+// --key=value / --flag arguments
+inline bool parse_options(int argc, char* argv[], Options& options, std::string& error) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            error = "unexpected argument '" + arg + "'";
+            return false;
+        }
+        std::size_t eq = arg.find('=');
+        std::string key = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (!apply_option(key, value, options, error)) return false;
+    }
+    return true;
+}
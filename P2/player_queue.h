@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "mpsc_ring.h"
+
+// One queued player: who, and when they joined the queue
+struct Player {
+    std::uint64_t id = 0;
+    std::chrono::steady_clock::time_point arrived;
+};
+
+using PlayerRing = MpscRing<Player>;
+
+// The player pool as three role queues (tanks, healers, DPS). Players keep
+// their identity and arrival time; a party takes the 1 tank, 1 healer and
+// 3 DPS that have waited longest. Arrivals never take a lock.
+class PlayerQueues {
+public:
+    enum Role { kTank = 0, kHealer = 1, kDps = 2, kRoleCount = 3 };
+
+    static constexpr long long kMaxPerRole = 1ll << 26;
+
+    struct Counts {
+        long long tanks = 0;
+        long long healers = 0;
+        long long dps = 0;
+    };
+
+    // each role's ring holds at least its capacity players; ids count up
+    // from first_id (shards use disjoint ranges, so migrated players stay unique)
+    PlayerQueues(std::size_t tank_capacity, std::size_t healer_capacity, std::size_t dps_capacity,
+                 std::uint64_t first_id = 1)
+        : rings{PlayerRing(tank_capacity), PlayerRing(healer_capacity), PlayerRing(dps_capacity)}, next_id(first_id) {}
+
+    Counts counts() const {
+        return {static_cast<long long>(rings[kTank].size()), static_cast<long long>(rings[kHealer].size()),
+                static_cast<long long>(rings[kDps].size())};
+    }
+
+    // queues count new players of a role; returns how many fit
+    long long add(Role role, long long count, std::chrono::steady_clock::time_point arrived) {
+        for (long long i = 0; i < count; ++i) {
+            Player p{next_id.fetch_add(1, std::memory_order_relaxed), arrived};
+            if (!rings[role].try_push(p)) return i;
+        }
+        return count;
+    }
+
+    // free slots left for a role (arrivals may take some meanwhile)
+    long long room(Role role) const {
+        return static_cast<long long>(rings[role].max_size()) - static_cast<long long>(rings[role].size());
+    }
+
+    // queues a player taken from another pool, keeping its id and arrival
+    // time (the shard balancer); false if the ring is full
+    bool put(Role role, const Player& player) { return rings[role].try_push(player); }
+
+    // --- consumer only ---
+
+    // takes the longest-waiting player of a role; false if none is ready
+    bool try_take(Role role, Player& out) {
+        if (!rings[role].front_ready(1)) return false;
+        out = rings[role].pop();
+        return true;
+    }
+
+    // takes the longest-waiting 1 tank, 1 healer and 3 DPS (out[0] tank,
+    // out[1] healer, out[2..4] DPS); false, and nothing taken, if any of
+    // them isn't queued yet
+    bool try_take_party(Player out[5]) {
+        if (!rings[kTank].front_ready(1) || !rings[kHealer].front_ready(1) || !rings[kDps].front_ready(3)) return false;
+        out[0] = rings[kTank].pop();
+        out[1] = rings[kHealer].pop();
+        for (int i = 2; i < 5; ++i) out[i] = rings[kDps].pop();
+        return true;
+    }
+
+    // the longest-waiting player of a role, nullptr if none
+    const Player* oldest(Role role) const { return rings[role].front(); }
+
+private:
+    PlayerRing rings[kRoleCount];
+    std::atomic<std::uint64_t> next_id{1};
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "instance_allocator.h"
+
+// A party the pool can form, waiting for the matchmaker. Its run time is
+// drawn when it becomes formable, so policies can look at it up front.
+struct PendingParty {
+    std::chrono::steady_clock::time_point ready_at;
+    int run_time = 0;                      // seconds
+};
+
+// The formable parties, bucketed by run time (t1..t2 is at most 16 values),
+// each bucket in the order its parties became formable. Picking the oldest
+// party or the shortest one only looks at the bucket fronts.
+class ReadyParties {
+public:
+    void reset(int min_run, int max_run) {
+        min_run_time = min_run;
+        by_run_time.assign(static_cast<std::size_t>(max_run - min_run + 1), {});
+        total = 0;
+    }
+
+    void push(const PendingParty& party) {
+        by_run_time[static_cast<std::size_t>(party.run_time - min_run_time)].push_back(party);
+        ++total;
+    }
+
+    std::size_t size() const { return total; }
+    int buckets() const { return static_cast<int>(by_run_time.size()); }
+
+    // oldest party in a bucket, nullptr if it is empty
+    const PendingParty* front(int bucket) const {
+        const auto& q = by_run_time[static_cast<std::size_t>(bucket)];
+        return q.empty() ? nullptr : &q.front();
+    }
+
+    PendingParty take(int bucket) {
+        auto& q = by_run_time[static_cast<std::size_t>(bucket)];
+        PendingParty party = q.front();
+        q.pop_front();
+        --total;
+        return party;
+    }
+
+private:
+    int min_run_time = 0;
+    std::vector<std::deque<PendingParty>> by_run_time;
+    std::size_t total = 0;
+};
+
+// How the matchmaker schedules (--policy=NAME):
+//   parties_to_form - how many parties to start now (0 = keep waiting)
+//   pick_party      - which formable party goes next (a ReadyParties bucket)
+//   pick_instance   - which empty instance it gets
+// Called by the matchmaker only, while it holds its lock.
+class SchedulingPolicy {
+public:
+    virtual ~SchedulingPolicy() = default;
+
+    virtual const char* name() const = 0;
+
+    virtual int parties_to_form(std::size_t formable, int free_instances, bool arrivals_done) const {
+        (void)arrivals_done;
+        return static_cast<int>(std::min<std::size_t>(formable, static_cast<std::size_t>(free_instances)));
+    }
+
+    // default: the party that has waited longest
+    virtual int pick_party(const ReadyParties& ready) const {
+        int best = -1;
+        for (int b = 0; b < ready.buckets(); ++b) {
+            const PendingParty* p = ready.front(b);
+            if (p && (best < 0 || p->ready_at < ready.front(best)->ready_at)) best = b;
+        }
+        return best;
+    }
+
+    // default: the lowest empty instance; time_served(i) is instance i's total so far
+    virtual int pick_instance(const InstanceAllocator& instances, const std::function<double(int)>& time_served) const {
+        (void)time_served;
+        int lowest = -1;
+        instances.for_each_free([&](int id) {
+            if (lowest < 0) lowest = id;
+        });
+        return lowest;
+    }
+};
+
+// fifo: parties in the order they became formable, lowest empty instance
+class FifoPolicy : public SchedulingPolicy {
+public:
+    const char* name() const override { return "fifo"; }
+};
+
+// serf: shortest expected run first (ties: the older party)
+class ShortestRunFirstPolicy : public SchedulingPolicy {
+public:
+    const char* name() const override { return "serf"; }
+
+    int pick_party(const ReadyParties& ready) const override {
+        for (int b = 0; b < ready.buckets(); ++b) {
+            if (ready.front(b)) return b;
+        }
+        return -1;
+    }
+};
+
+// least-loaded: fifo parties, into the empty instance with the least time served
+class LeastLoadedPolicy : public SchedulingPolicy {
+public:
+    const char* name() const override { return "least-loaded"; }
+
+    int pick_instance(const InstanceAllocator& instances, const std::function<double(int)>& time_served) const override {
+        int best = -1;
+        double best_time = 0;
+        instances.for_each_free([&](int id) {
+            double t = time_served(id);
+            if (best < 0 || t < best_time) {
+                best = id;
+                best_time = t;
+            }
+        });
+        return best;
+    }
+};
+
+// batch: wait until batch_size parties and instances are ready, then start
+// them together (whatever is left once arrivals are over goes at once)
+class BatchPolicy : public SchedulingPolicy {
+public:
+    explicit BatchPolicy(int batch_size) : batch_size(batch_size) {}
+
+    const char* name() const override { return "batch"; }
+
+    int parties_to_form(std::size_t formable, int free_instances, bool arrivals_done) const override {
+        int possible = SchedulingPolicy::parties_to_form(formable, free_instances, arrivals_done);
+        if (arrivals_done) return possible;
+        return possible >= batch_size ? possible - possible % batch_size : 0;
+    }
+
+private:
+    int batch_size;
+};
+
+// nullptr for an unknown name; batch_size is only used by "batch"
+inline std::unique_ptr<SchedulingPolicy> make_policy(const std::string& name, int batch_size) {
+    if (name == "fifo") return std::make_unique<FifoPolicy>();
+    if (name == "serf") return std::make_unique<ShortestRunFirstPolicy>();
+    if (name == "least-loaded") return std::make_unique<LeastLoadedPolicy>();
+    if (name == "batch") return std::make_unique<BatchPolicy>(batch_size);
+    return nullptr;
+}
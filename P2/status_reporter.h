@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "event_log.h"
+#include "instance_allocator.h"
+#include "player_queue.h"
+
+// How the reporter writes events (--events=FORMAT):
+//   text    - the "[Party 1] entered Instance 0. ..." lines, plus a status row
+//   json    - one JSON object per line: {"t_us":1234000,"ev":"enter",...}
+//   binary  - a "P2EV" + uint32 version header, then 32-byte QueueEvent records
+enum class EventFormat { Text, Json, Binary };
+
+inline bool parse_event_format(const std::string& name, EventFormat& format) {
+    if (name == "text") format = EventFormat::Text;
+    else if (name == "json") format = EventFormat::Json;
+    else if (name == "binary") format = EventFormat::Binary;
+    else return false;
+    return true;
+}
+
+// The only thing that writes events out. It drains the EventLog and, at a
+// fixed rate (if anything happened since the last one), adds a status
+// snapshot taken from the instance bitmap and the queue lengths - both read
+// lock-free, so nobody waits for the output. With --shards=K it gets one
+// allocator and one set of queues per shard and shows every shard.
+// start() runs it on its own thread; under --sim the caller poll()s it with
+// virtual times instead.
+class StatusReporter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    StatusReporter(EventLog& log, std::vector<const InstanceAllocator*> instances,
+                   std::vector<const PlayerQueues*> players, EventFormat format, std::ostream& out,
+                   Clock::time_point start, Clock::duration snapshot_every)
+        : log(log), instances(std::move(instances)), players(std::move(players)), format(format), out(out),
+          start_time(start),
+          snapshot_every(snapshot_every), next_snapshot(start) {
+        if (format == EventFormat::Binary) {
+            const char magic[4] = {'P', '2', 'E', 'V'};
+            const std::uint32_t version = 1;
+            out.write(magic, sizeof(magic));
+            out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        }
+    }
+
+    StatusReporter(const StatusReporter&) = delete;
+    StatusReporter& operator=(const StatusReporter&) = delete;
+
+    ~StatusReporter() { stop(); }
+
+    // writes the events logged so far, then a snapshot if one is due
+    void poll(Clock::time_point now) {
+        if (log.drain([this](const QueueEvent& e) { write_event(e); }) > 0) changed = true;
+        if (changed && now >= next_snapshot) {
+            write_snapshot(now);
+            changed = false;
+            while (next_snapshot <= now) next_snapshot += snapshot_every;
+        }
+    }
+
+    // background thread: drain every 10 ms, snapshot at the fixed rate
+    void start() {
+        running = true;
+        thread = std::thread([this] {
+            while (running.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                poll(Clock::now());
+            }
+        });
+    }
+
+    // stops the thread (if any) and writes what is left, with a last snapshot
+    void stop() {
+        if (thread.joinable()) {
+            running = false;
+            thread.join();
+        }
+        flush(Clock::now());
+    }
+
+    // everything still in the log, and a final snapshot if anything changed
+    void flush(Clock::time_point now) {
+        if (log.drain([this](const QueueEvent& e) { write_event(e); }) > 0) changed = true;
+        if (changed) write_snapshot(now);
+        changed = false;
+        out.flush();
+    }
+
+private:
+    void write_event(const QueueEvent& e) {
+        if (format == EventFormat::Binary) {
+            out.write(reinterpret_cast<const char*>(&e), sizeof(e));
+            return;
+        }
+        if (format == EventFormat::Json) {
+            out << "{\"t_us\":" << e.time_ns / 1000;
+            switch (e.type) {
+            case QueueEvent::kArrival:
+                out << ",\"ev\":\"arrival\",\"tanks\":" << e.a << ",\"healers\":" << e.b << ",\"dps\":" << e.c;
+                break;
+            case QueueEvent::kEnter:
+                out << ",\"ev\":\"enter\",\"party\":" << e.party << ",\"instance\":" << e.instance
+                    << ",\"run_s\":" << e.a;
+                break;
+            case QueueEvent::kFinish:
+                out << ",\"ev\":\"finish\",\"party\":" << e.party << ",\"instance\":" << e.instance;
+                break;
+            case QueueEvent::kTurnedAway:
+                out << ",\"ev\":\"turned_away\",\"players\":" << e.a;
+                break;
+            case QueueEvent::kMigrate:
+                out << ",\"ev\":\"migrate\",\"from\":" << e.party << ",\"to\":" << e.instance << ",\"role\":" << e.a
+                    << ",\"players\":" << e.b;
+                break;
+            }
+            out << "}\n";
+            return;
+        }
+        switch (e.type) {
+        case QueueEvent::kArrival:
+            out << "[Arrival] added " << e.a << "T " << e.b << "H " << e.c << "D\n";
+            break;
+        case QueueEvent::kEnter:
+            out << "[Party " << e.party << "] entered Instance " << e.instance << ". (Running for " << e.a << "s)\n";
+            break;
+        case QueueEvent::kFinish:
+            out << "[Party " << e.party << "] finished Instance " << e.instance << ".\n";
+            break;
+        case QueueEvent::kTurnedAway:
+            out << "[Arrival] queue is full, " << e.a << " players turned away\n";
+            break;
+        case QueueEvent::kMigrate:
+            out << "[Balancer] moved " << e.b
+                << (e.a == PlayerQueues::kTank ? "T" : e.a == PlayerQueues::kHealer ? "H" : "D")
+                << " from shard " << e.party << " to shard " << e.instance << "\n";
+            break;
+        }
+    }
+
+    void write_snapshot(Clock::time_point now) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_time).count();
+        std::uint64_t time_ns = static_cast<std::uint64_t>(ns < 0 ? 0 : ns);
+        const int shards = static_cast<int>(instances.size());
+        if (format == EventFormat::Binary) {
+            // one record per shard
+            for (int s = 0; s < shards; ++s) {
+                PlayerQueues::Counts queued = players[s]->counts();
+                QueueEvent e;
+                e.time_ns = time_ns;
+                e.type = QueueEvent::kStatus;
+                e.party = s;
+                e.instance = instances[s]->size() - instances[s]->free_count();
+                e.a = static_cast<std::int32_t>(queued.tanks);
+                e.b = static_cast<std::int32_t>(queued.healers);
+                e.c = static_cast<std::int32_t>(queued.dps);
+                write_event(e);
+            }
+            return;
+        }
+        PlayerQueues::Counts queued;
+        int active = 0;
+        for (int s = 0; s < shards; ++s) {
+            PlayerQueues::Counts c = players[s]->counts();
+            queued.tanks += c.tanks;
+            queued.healers += c.healers;
+            queued.dps += c.dps;
+            active += instances[s]->size() - instances[s]->free_count();
+        }
+        if (format == EventFormat::Json) {
+            // instances: one 0/1 string (shards separated by '|'), queued: totals
+            out << "{\"t_us\":" << time_ns / 1000 << ",\"ev\":\"status\",\"active\":"
+                << active << ",\"instances\":\"";
+            for (int s = 0; s < shards; ++s) {
+                if (s > 0) out << '|';
+                for (int i = 0; i < instances[s]->size(); ++i) out << (instances[s]->is_active(i) ? '1' : '0');
+            }
+            out << "\",\"queued\":[" << queued.tanks << "," << queued.healers << "," << queued.dps << "]}\n";
+            return;
+        }
+        for (int s = 0; s < shards; ++s) {
+            if (shards == 1) out << "Instance Status: |";
+            else out << "Shard " << s << " Status: |";
+            for (int i = 0; i < instances[s]->size(); ++i) {
+                out << " " << std::setw(8) << (instances[s]->is_active(i) ? "active" : "empty") << " |";
+            }
+            if (shards > 1) {
+                PlayerQueues::Counts c = players[s]->counts();
+                out << "  " << c.tanks << "T " << c.healers << "H " << c.dps << "D";
+            }
+            out << "\n";
+        }
+        out << "Queued: " << queued.tanks << "T " << queued.healers << "H " << queued.dps << "D\n";
+        out << "--------------------------------------------------------\n";
+    }
+
+    EventLog& log;
+    std::vector<const InstanceAllocator*> instances; // one per shard
+    std::vector<const PlayerQueues*> players;
+    EventFormat format;
+    std::ostream& out;
+    Clock::time_point start_time;
+    Clock::duration snapshot_every;
+    Clock::time_point next_snapshot;
+    bool changed = true;                   // something to show (starts with the first snapshot)
+    std::atomic<bool> running{false};
+    std::thread thread;
+};
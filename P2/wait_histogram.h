@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+
+// Wait times on a log2 scale: bucket 0 is < 1 ms, bucket b holds
+// [2^(b-1), 2^b) ms, the last one everything above. One writer (the
+// matchmaker), read after the run.
+class WaitHistogram {
+public:
+    static constexpr int kBuckets = 32;
+
+    void add(double ms) {
+        int b = 0;
+        while (b < kBuckets - 1 && ms >= static_cast<double>(1ull << b)) ++b;
+        ++buckets[b];
+        ++total;
+        sum += ms;
+        worst = std::max(worst, ms);
+    }
+
+    // adds everything other counted (e.g. another shard's waits)
+    void merge(const WaitHistogram& other) {
+        for (int b = 0; b < kBuckets; ++b) buckets[b] += other.buckets[b];
+        total += other.total;
+        sum += other.sum;
+        worst = std::max(worst, other.worst);
+    }
+
+    std::uint64_t count() const { return total; }
+    double average() const { return total ? sum / static_cast<double>(total) : 0; }
+    double max() const { return worst; }
+
+    // upper bound of the bucket holding the p-th percentile, in ms
+    double percentile(double p) const {
+        std::uint64_t rank = static_cast<std::uint64_t>(p / 100.0 * static_cast<double>(total) + 0.5);
+        if (rank < 1) rank = 1;
+        std::uint64_t seen = 0;
+        for (int b = 0; b < kBuckets; ++b) {
+            seen += buckets[b];
+            if (seen >= rank) return std::min(worst, static_cast<double>(1ull << b));
+        }
+        return worst;
+    }
+
+    // one "  [lo, hi) ms: count" line per non-empty bucket, after indent
+    void print_buckets(std::ostream& out, const char* indent) const {
+        for (int b = 0; b < kBuckets; ++b) {
+            if (buckets[b] == 0) continue;
+            std::uint64_t lo = b == 0 ? 0 : 1ull << (b - 1);
+            out << indent << "[" << lo << ", " << (1ull << b) << ") ms: " << buckets[b] << "\n";
+        }
+    }
+
+private:
+    std::uint64_t buckets[kBuckets] = {};
+    std::uint64_t total = 0;
+    double sum = 0;
+    double worst = 0;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fixed set of long-lived worker threads pulling jobs from one FIFO queue.
+// P2 starts one worker per instance, so the number of threads (and their
+// stacks) depends on n, not on how many parties get formed over the run.
+//   push(job) - queue a job for the next idle worker
+//   close()   - no more jobs; workers finish the queue, then exit
+//   join()    - wait for the workers (call close() first)
+// on_start (if set) runs first on every worker thread, e.g. to pin it.
+template <typename Job>
+class WorkerPool {
+public:
+    WorkerPool(int workers, std::function<void(int worker, const Job&)> handler,
+               std::function<void(int worker)> on_start = nullptr)
+        : handler(std::move(handler)), on_start(std::move(on_start)) {
+        for (int i = 0; i < workers; ++i) {
+            threads.emplace_back([this, i]() {
+                if (this->on_start) this->on_start(i);
+                worker_loop(i);
+            });
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool() {
+        close();
+        join();
+    }
+
+    void push(Job job) {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            jobs.push_back(std::move(job));
+        }
+        cv.notify_one();
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            closed = true;
+        }
+        cv.notify_all();
+    }
+
+    void join() {
+        for (auto& t : threads) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+private:
+    void worker_loop(int worker) {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&]() { return closed || !jobs.empty(); });
+                if (jobs.empty()) return; // closed and drained
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            handler(worker, job);
+        }
+    }
+
+    std::function<void(int, const Job&)> handler;
+    std::function<void(int)> on_start;
+    std::vector<std::thread> threads;
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<Job> jobs;
+    bool closed = false;
+};